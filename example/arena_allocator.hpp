@@ -0,0 +1,235 @@
+// Copyright (C) 2018 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A_ PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef EXAMPLE_ARENA_ALLOCATOR_H_
+#define EXAMPLE_ARENA_ALLOCATOR_H_
+
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+
+#include <sys/mman.h>
+
+namespace ex_m_thr {
+
+enum class HugePages {
+  None,
+  Transparent,
+  Explicit
+};
+
+// One mapping reserved up front, blocks are cut from it 64-byte aligned.
+// Freed blocks are kept by size and given out again, so the per-step
+// vectors of a solve are recycled instead of growing the arena.
+class Arena {
+public:
+  static constexpr std::size_t alignment = 64;
+  static constexpr std::size_t huge_page_size = std::size_t(2) << 20;
+
+  explicit Arena(std::size_t capacity, HugePages huge_pages = HugePages::None);
+  ~Arena();
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // Returns nullptr if the arena is exhausted.
+  void* allocate(std::size_t nbytes);
+  void deallocate(void* p, std::size_t nbytes) noexcept;
+  bool owns(const void* p) const noexcept;
+
+  std::size_t capacity() const;
+  std::size_t used() const;
+  // Explicit huge pages fall back to transparent ones if none are reserved
+  // in the system, this is what was actually got.
+  HugePages huge_pages() const;
+
+private:
+  static std::size_t round_up(std::size_t n, std::size_t to);
+
+  void* mapping_ {nullptr};
+  std::size_t mapping_size_ {0};
+  char* begin_ {nullptr};
+  std::size_t capacity_ {0};
+  std::size_t used_ {0};
+  HugePages huge_pages_ {HugePages::None};
+
+  mutable std::mutex mutex_;
+  // Freed blocks are linked through their own first bytes, so deallocate
+  // never allocates.
+  struct FreeBlock {
+    std::size_t nbytes;
+    FreeBlock* next;
+  };
+  static_assert(sizeof(FreeBlock) <= alignment, "FreeBlock must fit a block");
+  FreeBlock* free_ {nullptr};
+};
+
+inline std::size_t Arena::round_up(std::size_t n, std::size_t to) {
+  return (n + to - 1) / to * to;
+}
+
+inline Arena::Arena(std::size_t capacity, HugePages huge_pages)
+  : huge_pages_(huge_pages) {
+  if (capacity == 0)
+    throw std::runtime_error("Arena: capacity == 0!");
+
+  if (huge_pages_ == HugePages::Explicit) {
+    capacity_ = round_up(capacity, huge_page_size);
+    mapping_ = ::mmap(nullptr, capacity_, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (mapping_ == MAP_FAILED) {
+      mapping_ = nullptr;
+      huge_pages_ = HugePages::Transparent;
+    } else {
+      mapping_size_ = capacity_;
+      begin_ = static_cast<char*>(mapping_);
+    }
+  }
+
+  if (mapping_ == nullptr) {
+    // Transparent huge pages need a 2 MB aligned range.
+    const bool thp = huge_pages_ == HugePages::Transparent;
+    capacity_ = round_up(capacity, thp ? huge_page_size : alignment);
+    mapping_size_ = capacity_ + (thp ? huge_page_size : 0);
+    mapping_ = ::mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping_ == MAP_FAILED)
+      throw std::bad_alloc();
+
+    const auto addr = reinterpret_cast<std::uintptr_t>(mapping_);
+    begin_ = static_cast<char*>(mapping_)
+      + (thp ? round_up(addr, huge_page_size) - addr : 0);
+#ifdef MADV_HUGEPAGE
+    if (thp)
+      ::madvise(begin_, capacity_, MADV_HUGEPAGE);
+#endif
+  }
+}
+
+inline Arena::~Arena() { ::munmap(mapping_, mapping_size_); }
+
+inline void* Arena::allocate(std::size_t nbytes) {
+  nbytes = round_up(nbytes == 0 ? 1 : nbytes, alignment);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (FreeBlock** link = &free_; *link != nullptr; link = &(*link)->next)
+    if ((*link)->nbytes == nbytes) {
+      FreeBlock* block = *link;
+      *link = block->next;
+      return block;
+    }
+
+  if (capacity_ - used_ < nbytes)
+    return nullptr;
+
+  void* p = begin_ + used_;
+  used_ += nbytes;
+  return p;
+}
+
+inline void Arena::deallocate(void* p, std::size_t nbytes) noexcept {
+  nbytes = round_up(nbytes == 0 ? 1 : nbytes, alignment);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (static_cast<char*>(p) + nbytes == begin_ + used_) {
+    used_ -= nbytes;
+  } else {
+    free_ = new (p) FreeBlock {nbytes, free_};
+  }
+}
+
+// Pointers into unrelated objects are compared as integers.
+inline bool Arena::owns(const void* p) const noexcept {
+  const auto addr = reinterpret_cast<std::uintptr_t>(p);
+  const auto begin = reinterpret_cast<std::uintptr_t>(begin_);
+  return addr >= begin && addr - begin < capacity_;
+}
+
+inline std::size_t Arena::capacity() const { return capacity_; }
+
+inline std::size_t Arena::used() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return used_;
+}
+
+inline HugePages Arena::huge_pages() const { return huge_pages_; }
+
+// 64-byte aligned allocator. With an arena the memory is taken from it,
+// without one or when the arena is exhausted from the aligned operator new.
+template <typename T>
+class ArenaAllocator {
+public:
+  using value_type = T;
+
+  ArenaAllocator() noexcept = default;
+  explicit ArenaAllocator(Arena* arena) noexcept : arena_(arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+    : arena_(other.arena()) {}
+
+  T* allocate(std::size_t n);
+  void deallocate(T* p, std::size_t n) noexcept;
+
+  Arena* arena() const noexcept { return arena_; }
+
+private:
+  Arena* arena_ {nullptr};
+};
+
+template <typename T>
+T* ArenaAllocator<T>::allocate(std::size_t n) {
+  if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+    throw std::bad_alloc();
+
+  if (arena_ != nullptr)
+    if (void* p = arena_->allocate(n * sizeof(T)))
+      return static_cast<T*>(p);
+
+  return static_cast<T*>(
+    ::operator new(n * sizeof(T), std::align_val_t(Arena::alignment)));
+}
+
+template <typename T>
+void ArenaAllocator<T>::deallocate(T* p, std::size_t n) noexcept {
+  if (arena_ != nullptr && arena_->owns(p)) {
+    arena_->deallocate(p, n * sizeof(T));
+    return;
+  }
+
+  ::operator delete(p, std::align_val_t(Arena::alignment));
+}
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return !(a == b);
+}
+
+} // namespace ex_m_thr
+
+#endif // EXAMPLE_ARENA_ALLOCATOR_H_
@@ -23,102 +23,233 @@
 #ifndef EXAMPLE_BLOCK_JACOBI_H_
 #define EXAMPLE_BLOCK_JACOBI_H_
 
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
 #include <thread>
 #include <vector>
 
+#include "level_schedule.hpp"
+#include "thread_pool.hpp"
+
 namespace ex_m_thr {
 
-template <typename T = float>
+// Row ranges of the blocks, the first nrows % nblocks blocks get one more row.
+inline std::vector<std::size_t> block_offsets(
+    std::size_t nrows, std::size_t nblocks) {
+  std::size_t offset = nrows / nblocks;
+  std::size_t balance = nrows - offset * nblocks;
+
+  std::vector<std::size_t> offsets;
+  std::size_t start {0};
+  offsets.reserve(nblocks + 1);
+  offsets.push_back(start);
+  for (std::size_t i = 0; i < balance; ++i) {
+    start += offset + 1;
+    offsets.push_back(start);
+  }
+  for (std::size_t i = balance; i < nblocks; ++i) {
+    start += offset;
+    offsets.push_back(start);
+  }
+
+  return offsets;
+}
+
+template <typename T = float, typename Allocator = std::allocator<T>>
 class BlockJacobi {
 public:
-  BlockJacobi<T>();
-  ~BlockJacobi<T>();
-  BlockJacobi<T>(const BlockJacobi<T>&);
-  BlockJacobi<T>(BlockJacobi<T>&&);
-  BlockJacobi<T>& operator=(const BlockJacobi<T>&);
-  BlockJacobi<T>& operator=(BlockJacobi<T>&&);
+  using Vector = std::vector<T, Allocator>;
+
+  BlockJacobi<T, Allocator>();
+  ~BlockJacobi<T, Allocator>();
+  BlockJacobi<T, Allocator>(const BlockJacobi<T, Allocator>&);
+  BlockJacobi<T, Allocator>(BlockJacobi<T, Allocator>&&);
+  BlockJacobi<T, Allocator>& operator=(const BlockJacobi<T, Allocator>&);
+  BlockJacobi<T, Allocator>& operator=(BlockJacobi<T, Allocator>&&);
 
-  BlockJacobi<T>(std::size_t nbs, std::size_t nrows, const std::vector<T>& A);
+  BlockJacobi<T, Allocator>(
+    std::size_t nbs,
+    std::size_t nrows,
+    const Vector& A,
+    std::size_t nlevels = 1,
+    std::size_t overlap = 0,
+    std::size_t nthreads = 0);
 
-  std::vector<T> step_solution_gauss_seidel(
-    const std::vector<T>& lhs, const std::vector<T>& rhs);
-  std::vector<T> times(const std::vector<T>& rhs) const;
+  Vector step_solution_gauss_seidel(
+    const Vector& lhs, const Vector& rhs);
+  // With nlevels == 2 the coarse correction is applied before and after the
+  // sweeps, so for a symmetric A the step stays symmetric and may be used as
+  // a CG preconditioner. overlap > 0 writes back only the own rows of a block
+  // (restricted Schwarz), which makes the step non-symmetric.
+  Vector step_solution_symmetric_gauss_seidel(
+    const Vector& lhs, const Vector& rhs);
+  Vector step_solution_ssor(
+    const Vector& lhs, const Vector& rhs, T w);
+  Vector times(const Vector& rhs) const;
+
+  std::size_t nlevels() const;
+  std::size_t overlap() const;
+  std::size_t nthreads_per_block() const;
+
+  // Blocks are run as tasks of the pool instead of own threads.
+  void set_thread_pool(ThreadPool* pool);
 
 private:
+  template <typename F>
+  void for_each_block(F f) const;
+
   void step_solution_gauss_seidel_thr(
-    const std::vector<T>& lhs,
-    const std::vector<T>& rhs,
-    std::vector<T>& lhs_new,
+    const Vector& lhs,
+    const Vector& rhs,
+    Vector& lhs_new,
     std::uint32_t thr_id);
+  void step_solution_ssor_thr(
+    const Vector& lhs,
+    const Vector& rhs,
+    Vector& lhs_new,
+    T w,
+    std::uint32_t thr_id);
+
+  void coarse_correction(Vector& lhs, const Vector& rhs) const;
+  void restrict_residual_thr(
+    const Vector& lhs,
+    const Vector& rhs,
+    Vector& r_coarse,
+    std::uint32_t thr_id) const;
+  void factorize_coarse();
+  Vector solve_coarse(Vector r_coarse) const;
 
   const std::size_t nrows_;
-  std::vector<T> A_;
+  Vector A_;
 
   const std::size_t nblocks_;
   std::vector<std::size_t> offsets_;
+  // Restricted additive Schwarz: every block is solved on its rows extended
+  // by overlap_ rows on each side, but only its own rows are written back.
+  const std::size_t overlap_;
+
+  // Threads left over when there are fewer blocks than nthreads sweep each
+  // block level by level. nthreads == 0 means all cores.
+  std::size_t nthreads_per_block_;
+  std::vector<LevelSchedule<T>> schedules_;
+
+  ThreadPool* pool_ {nullptr};
+
+  // Two-level hybrid (multiplicative) Schwarz: the coarse correction follows
+  // the block sweeps. The coarse space has one aggregate per block,
+  // coarse_lu_ holds the LU factors of P^T A P.
+  const std::size_t nlevels_;
+  Vector coarse_lu_;
+  std::vector<std::size_t> coarse_pivots_;
 };
 
-template <typename T>
-BlockJacobi<T>::BlockJacobi() = default;
+template <typename T, typename Allocator>
+BlockJacobi<T, Allocator>::BlockJacobi() = default;
 
-template <typename T>
-BlockJacobi<T>::~BlockJacobi() = default;
+template <typename T, typename Allocator>
+BlockJacobi<T, Allocator>::~BlockJacobi() = default;
 
-template <typename T>
-BlockJacobi<T>::BlockJacobi(const BlockJacobi<T>&) = default;
+template <typename T, typename Allocator>
+BlockJacobi<T, Allocator>::BlockJacobi(
+    const BlockJacobi<T, Allocator>&) = default;
 
-template <typename T>
-BlockJacobi<T>::BlockJacobi(BlockJacobi<T>&&) = default;
+template <typename T, typename Allocator>
+BlockJacobi<T, Allocator>::BlockJacobi(BlockJacobi<T, Allocator>&&) = default;
 
-template <typename T>
-BlockJacobi<T>& BlockJacobi<T>::operator=(const BlockJacobi<T>&) = default;
+template <typename T, typename Allocator>
+BlockJacobi<T, Allocator>&
+BlockJacobi<T, Allocator>::operator=(const BlockJacobi<T, Allocator>&) = default;
 
-template <typename T>
-BlockJacobi<T>& BlockJacobi<T>::operator=(BlockJacobi<T>&&) = default;
+template <typename T, typename Allocator>
+BlockJacobi<T, Allocator>&
+BlockJacobi<T, Allocator>::operator=(BlockJacobi<T, Allocator>&&) = default;
 
-template <typename T>
-BlockJacobi<T>::BlockJacobi(
-    std::size_t nblocks, std::size_t nrows, const std::vector<T>& A)
-  : nblocks_(nblocks), nrows_(nrows), A_(A) {
-  std::size_t offset = nrows_ / nblocks_;
-  std::size_t balance = nrows_ - offset * nblocks_;
+template <typename T, typename Allocator>
+BlockJacobi<T, Allocator>::BlockJacobi(
+    std::size_t nblocks,
+    std::size_t nrows,
+    const Vector& A,
+    std::size_t nlevels,
+    std::size_t overlap,
+    std::size_t nthreads)
+  : nblocks_(nblocks), nrows_(nrows), A_(A), overlap_(overlap),
+    nlevels_(nlevels), coarse_lu_(A.get_allocator()) {
+  if (nlevels_ != 1 && nlevels_ != 2)
+    throw std::runtime_error("BlockJacobi: nlevels must be 1 or 2!");
 
-  std::size_t start {0};
-  offsets_.reserve(nblocks_ + 1);
-  offsets_.push_back(start);
-  for (std::size_t i = 0; i < balance; ++i) {
-    start += offset + 1;
-    offsets_.push_back(start);
-  }
-  for (std::size_t i = balance; i < nblocks_; ++i) {
-    start += offset;
-    offsets_.push_back(start);
+  offsets_ = block_offsets(nrows_, nblocks_);
+
+  if (nlevels_ == 2)
+    factorize_coarse();
+
+  if (nthreads == 0)
+    nthreads = std::thread::hardware_concurrency();
+  nthreads_per_block_ = nthreads / nblocks_;
+  if (nthreads_per_block_ > 1) {
+    schedules_.reserve(nblocks_);
+    for (std::size_t k = 0; k < nblocks_; ++k) {
+      const std::size_t at = offsets_[k];
+      const std::size_t ext_at = at > overlap_ ? at - overlap_ : 0;
+      schedules_.emplace_back(nrows_, A_, ext_at, offsets_[k + 1]);
+    }
   }
 }
 
-template <typename T>
-std::vector<T> BlockJacobi<T>::step_solution_gauss_seidel(
-    const std::vector<T>& lhs,
-    const std::vector<T>& rhs) {
-  std::vector<T> lhs_new(rhs);
+template <typename T, typename Allocator>
+typename BlockJacobi<T, Allocator>::Vector
+BlockJacobi<T, Allocator>::step_solution_gauss_seidel(
+    const Vector& lhs,
+    const Vector& rhs) {
+  Vector lhs_new(rhs);
 
-  std::vector<std::thread> threads;
-  for (std::size_t k = 0; k < nblocks_; ++k) {
-    std::thread thr([&lhs, &rhs, &lhs_new, k, this] {
-      step_solution_gauss_seidel_thr(lhs, rhs, lhs_new, k);
-    }); 
-    threads.emplace_back(std::move(thr));
+  for_each_block([&lhs, &rhs, &lhs_new, this](std::size_t k) {
+    step_solution_gauss_seidel_thr(lhs, rhs, lhs_new, k);
+  });
+
+  if (nlevels_ == 2)
+    coarse_correction(lhs_new, rhs);
+
+  return lhs_new;
+}
+
+template <typename T, typename Allocator>
+typename BlockJacobi<T, Allocator>::Vector
+BlockJacobi<T, Allocator>::step_solution_symmetric_gauss_seidel(
+    const Vector& lhs,
+    const Vector& rhs) {
+  return step_solution_ssor(lhs, rhs, T(1));
+}
+
+template <typename T, typename Allocator>
+typename BlockJacobi<T, Allocator>::Vector
+BlockJacobi<T, Allocator>::step_solution_ssor(
+    const Vector& lhs,
+    const Vector& rhs,
+    T w) {
+  Vector lhs_pre(lhs.get_allocator());
+  if (nlevels_ == 2) {
+    lhs_pre = lhs;
+    coarse_correction(lhs_pre, rhs);
   }
+  const Vector& x = nlevels_ == 2 ? lhs_pre : lhs;
+  Vector lhs_new(x);
 
-  for(auto& thr : threads)
-    thr.join();
+  for_each_block([&x, &rhs, &lhs_new, w, this](std::size_t k) {
+    step_solution_ssor_thr(x, rhs, lhs_new, w, k);
+  });
+
+  if (nlevels_ == 2)
+    coarse_correction(lhs_new, rhs);
 
   return lhs_new;
 }
 
-template <typename T>
-std::vector<T> BlockJacobi<T>::times(const std::vector<T>& rhs) const {
-  std::vector<T> result;
+template <typename T, typename Allocator>
+typename BlockJacobi<T, Allocator>::Vector
+BlockJacobi<T, Allocator>::times(const Vector& rhs) const {
+  Vector result(A_.get_allocator());
   result.reserve(rhs.size());
   for (std::size_t k = 0; k < nblocks_; ++k) {
     const std::size_t at = offsets_[k];
@@ -135,24 +266,210 @@ std::vector<T> BlockJacobi<T>::times(const std::vector<T>& rhs) const {
   return result;
 }
 
-template <typename T>
-void BlockJacobi<T>::step_solution_gauss_seidel_thr(
-    const std::vector<T>& lhs,
-    const std::vector<T>& rhs,
-    std::vector<T>& lhs_new,
+template <typename T, typename Allocator>
+std::size_t BlockJacobi<T, Allocator>::nlevels() const { return nlevels_; }
+
+template <typename T, typename Allocator>
+std::size_t BlockJacobi<T, Allocator>::overlap() const { return overlap_; }
+
+template <typename T, typename Allocator>
+std::size_t BlockJacobi<T, Allocator>::nthreads_per_block() const {
+  return nthreads_per_block_;
+}
+
+template <typename T, typename Allocator>
+void BlockJacobi<T, Allocator>::set_thread_pool(ThreadPool* pool) { pool_ = pool; }
+
+template <typename T, typename Allocator>
+template <typename F>
+void BlockJacobi<T, Allocator>::for_each_block(F f) const {
+  if (pool_ != nullptr) {
+    pool_->parallel_for(nblocks_, f);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  for (std::size_t k = 0; k < nblocks_; ++k) {
+    std::thread thr([&f, k] { f(k); });
+    threads.emplace_back(std::move(thr));
+  }
+
+  for(auto& thr : threads)
+    thr.join();
+}
+
+template <typename T, typename Allocator>
+void BlockJacobi<T, Allocator>::step_solution_gauss_seidel_thr(
+    const Vector& lhs,
+    const Vector& rhs,
+    Vector& lhs_new,
     std::uint32_t thr_id) {
   const std::size_t at = offsets_[thr_id];
   const std::size_t to = offsets_[thr_id + 1];
+  // The rows after `to` can not change the own rows in a forward sweep,
+  // so only the leading overlap is swept.
+  const std::size_t ext_at = at > overlap_ ? at - overlap_ : 0;
 
-  for (std::size_t i = at; i < to; ++i) {
-    for (std::size_t j = at; j < i; ++j)
-      lhs_new[i] -= A_[i * nrows_ + j] * lhs_new[j];
+  Vector x(rhs.begin() + ext_at, rhs.begin() + to, A_.get_allocator());
+  // The level sweep starts own threads, it is not used on a shared pool.
+  if (pool_ == nullptr && !schedules_.empty()
+      && schedules_[thr_id].is_parallel(nthreads_per_block_)) {
+    schedules_[thr_id].step_solution_gauss_seidel(
+      A_, lhs, x.data(), nthreads_per_block_);
+  } else {
+    for (std::size_t i = ext_at; i < to; ++i) {
+      T& xi = x[i - ext_at];
 
-    for (std::size_t j = i + 1; j < to; ++j)
-      lhs_new[i] -= A_[i * nrows_ + j] * lhs[j];
+      // Coupling outside the extended block is taken from the previous iterate.
+      for (std::size_t j = 0; j < ext_at; ++j)
+        xi -= A_[i * nrows_ + j] * lhs[j];
 
-    lhs_new[i] /= A_[i * nrows_ + i];
+      for (std::size_t j = ext_at; j < i; ++j)
+        xi -= A_[i * nrows_ + j] * x[j - ext_at];
+
+      for (std::size_t j = i + 1; j < nrows_; ++j)
+        xi -= A_[i * nrows_ + j] * lhs[j];
+
+      xi /= A_[i * nrows_ + i];
+    }
   }
+
+  std::copy(x.begin() + (at - ext_at), x.end(), lhs_new.begin() + at);
+}
+
+// Both sweeps run over the block while its rows are in cache. The coupling
+// outside the extended block does not change between them and is summed once.
+template <typename T, typename Allocator>
+void BlockJacobi<T, Allocator>::step_solution_ssor_thr(
+    const Vector& lhs,
+    const Vector& rhs,
+    Vector& lhs_new,
+    T w,
+    std::uint32_t thr_id) {
+  const std::size_t at = offsets_[thr_id];
+  const std::size_t to = offsets_[thr_id + 1];
+  // Unlike the forward sweep, the backward one carries the trailing overlap
+  // back into the own rows.
+  const std::size_t ext_at = at > overlap_ ? at - overlap_ : 0;
+  const std::size_t ext_to = std::min(to + overlap_, nrows_);
+
+  Vector r(rhs.begin() + ext_at, rhs.begin() + ext_to, A_.get_allocator());
+  Vector x(lhs.begin() + ext_at, lhs.begin() + ext_to, A_.get_allocator());
+
+  auto update = [this, &r, &x, ext_at, ext_to, w](std::size_t i) {
+    T ri = r[i - ext_at];
+    for (std::size_t j = ext_at; j < i; ++j)
+      ri -= A_[i * nrows_ + j] * x[j - ext_at];
+
+    for (std::size_t j = i + 1; j < ext_to; ++j)
+      ri -= A_[i * nrows_ + j] * x[j - ext_at];
+
+    x[i - ext_at] += w * (ri / A_[i * nrows_ + i] - x[i - ext_at]);
+  };
+
+  for (std::size_t i = ext_at; i < ext_to; ++i) {
+    for (std::size_t j = 0; j < ext_at; ++j)
+      r[i - ext_at] -= A_[i * nrows_ + j] * lhs[j];
+
+    for (std::size_t j = ext_to; j < nrows_; ++j)
+      r[i - ext_at] -= A_[i * nrows_ + j] * lhs[j];
+
+    update(i);
+  }
+
+  for (std::size_t i = ext_to; i-- > ext_at;)
+    update(i);
+
+  std::copy(x.begin() + (at - ext_at), x.begin() + (to - ext_at),
+    lhs_new.begin() + at);
+}
+
+// lhs += P (P^T A P)^{-1} P^T (rhs - A lhs). It is applied after the block
+// sweeps rather than added to them: the purely additive update overshoots
+// the components that both levels correct and diverges already for
+// 8 blocks of a 1D Laplacian.
+template <typename T, typename Allocator>
+void BlockJacobi<T, Allocator>::coarse_correction(
+    Vector& lhs, const Vector& rhs) const {
+  Vector r_coarse(nblocks_, T(0), A_.get_allocator());
+  for_each_block([&lhs, &rhs, &r_coarse, this](std::size_t k) {
+    restrict_residual_thr(lhs, rhs, r_coarse, k);
+  });
+
+  Vector e_coarse = solve_coarse(std::move(r_coarse));
+  for (std::size_t k = 0; k < nblocks_; ++k)
+    for (std::size_t i = offsets_[k]; i < offsets_[k + 1]; ++i)
+      lhs[i] += e_coarse[k];
+}
+
+template <typename T, typename Allocator>
+void BlockJacobi<T, Allocator>::restrict_residual_thr(
+    const Vector& lhs,
+    const Vector& rhs,
+    Vector& r_coarse,
+    std::uint32_t thr_id) const {
+  T r {0.0};
+  for (std::size_t i = offsets_[thr_id]; i < offsets_[thr_id + 1]; ++i) {
+    r += rhs[i];
+    for (std::size_t j = 0; j < nrows_; ++j)
+      r -= A_[i * nrows_ + j] * lhs[j];
+  }
+  r_coarse[thr_id] = r;
+}
+
+template <typename T, typename Allocator>
+void BlockJacobi<T, Allocator>::factorize_coarse() {
+  // Blocks past nrows_ are empty, they have no aggregate and would give zero
+  // rows of P^T A P. The empty blocks are the trailing ones.
+  const std::size_t nc = std::min(nblocks_, nrows_);
+  coarse_lu_.assign(nc * nc, T(0));
+  for (std::size_t k = 0; k < nc; ++k)
+    for (std::size_t i = offsets_[k]; i < offsets_[k + 1]; ++i)
+      for (std::size_t l = 0; l < nc; ++l)
+        for (std::size_t j = offsets_[l]; j < offsets_[l + 1]; ++j)
+          coarse_lu_[k * nc + l] += A_[i * nrows_ + j];
+
+  // LU with partial pivoting.
+  coarse_pivots_.resize(nc);
+  for (std::size_t k = 0; k < nc; ++k) {
+    std::size_t p = k;
+    for (std::size_t i = k + 1; i < nc; ++i)
+      if (std::abs(coarse_lu_[i * nc + k]) > std::abs(coarse_lu_[p * nc + k]))
+        p = i;
+    if (coarse_lu_[p * nc + k] == T(0))
+      throw std::runtime_error("BlockJacobi: coarse matrix is singular!");
+
+    coarse_pivots_[k] = p;
+    if (p != k)
+      for (std::size_t j = 0; j < nc; ++j)
+        std::swap(coarse_lu_[k * nc + j], coarse_lu_[p * nc + j]);
+
+    for (std::size_t i = k + 1; i < nc; ++i) {
+      T m = coarse_lu_[i * nc + k] /= coarse_lu_[k * nc + k];
+      for (std::size_t j = k + 1; j < nc; ++j)
+        coarse_lu_[i * nc + j] -= m * coarse_lu_[k * nc + j];
+    }
+  }
+}
+
+template <typename T, typename Allocator>
+typename BlockJacobi<T, Allocator>::Vector
+BlockJacobi<T, Allocator>::solve_coarse(Vector r_coarse) const {
+  const std::size_t nc = std::min(nblocks_, nrows_);
+  for (std::size_t k = 0; k < nc; ++k)
+    std::swap(r_coarse[k], r_coarse[coarse_pivots_[k]]);
+
+  for (std::size_t i = 0; i < nc; ++i)
+    for (std::size_t j = 0; j < i; ++j)
+      r_coarse[i] -= coarse_lu_[i * nc + j] * r_coarse[j];
+
+  for (std::size_t i = nc; i-- > 0;) {
+    for (std::size_t j = i + 1; j < nc; ++j)
+      r_coarse[i] -= coarse_lu_[i * nc + j] * r_coarse[j];
+    r_coarse[i] /= coarse_lu_[i * nc + i];
+  }
+
+  return r_coarse;
 }
 
 } // namespace ex_m_thr
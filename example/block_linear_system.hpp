@@ -25,92 +25,161 @@
 
 #include <cmath>
 #include <initializer_list>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
 #include "block_jacobi.hpp"
 #include "linear_system.hpp"
+#include "reordering.hpp"
 
 namespace ex_m_thr {
 
-template <typename T = float>
-class BlockLinearSystem : public LinearSystem<T> {
+template <typename T = float, typename Allocator = std::allocator<T>>
+class BlockLinearSystem : public LinearSystem<T, Allocator> {
 public:
-  BlockLinearSystem<T>();
-  virtual ~BlockLinearSystem<T>();
-  BlockLinearSystem<T>(const BlockLinearSystem<T>&);
-  BlockLinearSystem<T>(BlockLinearSystem<T>&&);
-  BlockLinearSystem<T>& operator=(const BlockLinearSystem<T>&);
-  BlockLinearSystem<T>& operator=(BlockLinearSystem<T>&&);
-
-  BlockLinearSystem<T>(
+  using Vector = typename LinearSystem<T, Allocator>::Vector;
+
+  BlockLinearSystem<T, Allocator>();
+  virtual ~BlockLinearSystem<T, Allocator>();
+  BlockLinearSystem<T, Allocator>(const BlockLinearSystem<T, Allocator>&);
+  BlockLinearSystem<T, Allocator>(BlockLinearSystem<T, Allocator>&&);
+  BlockLinearSystem<T, Allocator>& operator=(const BlockLinearSystem<T, Allocator>&);
+  BlockLinearSystem<T, Allocator>& operator=(BlockLinearSystem<T, Allocator>&&);
+
+  // The blocks share nthreads threads, 0 means all cores.
+  BlockLinearSystem<T, Allocator>(
     std::size_t nblocks,
     std::size_t max_steps,
     T accuracy,
     std::size_t nrows,
     const std::vector<T>& A,
-    const std::vector<T>& rhs);
-
-  BlockLinearSystem<T>(
+    const std::vector<T>& rhs,
+    Ordering ordering = Ordering::Natural,
+    std::size_t nlevels = 1,
+    std::size_t overlap = 0,
+    std::size_t nthreads = 0,
+    const Allocator& alloc = Allocator());
+
+  BlockLinearSystem<T, Allocator>(
     std::size_t nblocks,
     std::size_t max_steps,
     T accuracy,
     std::size_t nrows,
     std::initializer_list<T> A,
-    std::initializer_list<T> rhs);
+    std::initializer_list<T> rhs,
+    Ordering ordering = Ordering::Natural,
+    std::size_t nlevels = 1,
+    std::size_t overlap = 0,
+    std::size_t nthreads = 0,
+    const Allocator& alloc = Allocator());
+
+  virtual void set_thread_pool(ThreadPool* pool) override;
 
 private:
-  virtual std::vector<T> step_solution_gauss_seidel() override;
+  virtual Vector step_solution_gauss_seidel() override;
+  virtual Vector step_solution_symmetric_gauss_seidel() override;
+  virtual Vector step_solution_ssor(T w = 0.5) override;
+  const Vector& reordered_matrix(Ordering ordering, std::size_t nblocks);
 
-  BlockJacobi<T> preconditioner_;
+  BlockJacobi<T, Allocator> preconditioner_;
 };
 
-template <typename T>
-BlockLinearSystem<T>::BlockLinearSystem()
-  : LinearSystem<T>(), preconditioner_(2, this->nrows_, this->A_) {};
+template <typename T, typename Allocator>
+BlockLinearSystem<T, Allocator>::BlockLinearSystem()
+  : LinearSystem<T, Allocator>(), preconditioner_(2, this->nrows_, this->A_) {};
 
-template <typename T>
-BlockLinearSystem<T>::~BlockLinearSystem() = default;
+template <typename T, typename Allocator>
+BlockLinearSystem<T, Allocator>::~BlockLinearSystem() = default;
 
-template <typename T>
-BlockLinearSystem<T>::BlockLinearSystem(const BlockLinearSystem<T>&) = default;
+template <typename T, typename Allocator>
+BlockLinearSystem<T, Allocator>::BlockLinearSystem(
+    const BlockLinearSystem<T, Allocator>&) = default;
 
-template <typename T>
-BlockLinearSystem<T>::BlockLinearSystem(BlockLinearSystem<T>&&) = default;
+template <typename T, typename Allocator>
+BlockLinearSystem<T, Allocator>::BlockLinearSystem(
+    BlockLinearSystem<T, Allocator>&&) = default;
 
-template <typename T>
-BlockLinearSystem<T>& BlockLinearSystem<T>::operator=(const BlockLinearSystem<T>&) = default;
+template <typename T, typename Allocator>
+BlockLinearSystem<T, Allocator>&
+BlockLinearSystem<T, Allocator>::operator=(const BlockLinearSystem<T, Allocator>&) = default;
 
-template <typename T>
-BlockLinearSystem<T>& BlockLinearSystem<T>::operator=(BlockLinearSystem<T>&&) = default;
+template <typename T, typename Allocator>
+BlockLinearSystem<T, Allocator>&
+BlockLinearSystem<T, Allocator>::operator=(BlockLinearSystem<T, Allocator>&&) = default;
 
-template <typename T>
-BlockLinearSystem<T>::BlockLinearSystem(
+template <typename T, typename Allocator>
+BlockLinearSystem<T, Allocator>::BlockLinearSystem(
     std::size_t nblocks,
     std::size_t max_steps,
     T accuracy,
     std::size_t nrows,
     const std::vector<T>& A,
-    const std::vector<T>& rhs)
-  : LinearSystem<T>(max_steps, accuracy, nrows, A, rhs),
-    preconditioner_(nblocks, this->nrows_, this->A_) {};
-
-template <typename T>
-BlockLinearSystem<T>::BlockLinearSystem(
+    const std::vector<T>& rhs,
+    Ordering ordering,
+    std::size_t nlevels,
+    std::size_t overlap,
+    std::size_t nthreads,
+    const Allocator& alloc)
+  : LinearSystem<T, Allocator>(max_steps, accuracy, nrows, A, rhs, 1, alloc),
+    preconditioner_(
+      nblocks, this->nrows_, reordered_matrix(ordering, nblocks),
+      nlevels, overlap, nthreads) {};
+
+template <typename T, typename Allocator>
+BlockLinearSystem<T, Allocator>::BlockLinearSystem(
     std::size_t nblocks,
     std::size_t max_steps,
     T accuracy,
     std::size_t nrows,
     std::initializer_list<T> A,
-    std::initializer_list<T> rhs)
-  : LinearSystem<T>(max_steps, accuracy, nrows, A, rhs),
-    preconditioner_(nblocks, this->nrows_, this->A_) {};
+    std::initializer_list<T> rhs,
+    Ordering ordering,
+    std::size_t nlevels,
+    std::size_t overlap,
+    std::size_t nthreads,
+    const Allocator& alloc)
+  : LinearSystem<T, Allocator>(max_steps, accuracy, nrows, A, rhs, 1, alloc),
+    preconditioner_(
+      nblocks, this->nrows_, reordered_matrix(ordering, nblocks),
+      nlevels, overlap, nthreads) {};
+
+template <typename T, typename Allocator>
+void BlockLinearSystem<T, Allocator>::set_thread_pool(ThreadPool* pool) {
+  LinearSystem<T, Allocator>::set_thread_pool(pool);
+  preconditioner_.set_thread_pool(pool);
+}
 
-template <typename T>
-std::vector<T> BlockLinearSystem<T>::step_solution_gauss_seidel() {
+template <typename T, typename Allocator>
+typename BlockLinearSystem<T, Allocator>::Vector
+BlockLinearSystem<T, Allocator>::step_solution_gauss_seidel() {
   return preconditioner_.step_solution_gauss_seidel(this->lhs_, this->rhs_);
 }
 
+template <typename T, typename Allocator>
+typename BlockLinearSystem<T, Allocator>::Vector
+BlockLinearSystem<T, Allocator>::step_solution_symmetric_gauss_seidel() {
+  return preconditioner_.step_solution_symmetric_gauss_seidel(
+    this->lhs_, this->rhs_);
+}
+
+template <typename T, typename Allocator>
+typename BlockLinearSystem<T, Allocator>::Vector
+BlockLinearSystem<T, Allocator>::step_solution_ssor(T w) {
+  return preconditioner_.step_solution_ssor(this->lhs_, this->rhs_, w);
+}
+
+// Is called before preconditioner_ is built, so that the blocks are cut
+// from the permuted matrix.
+template <typename T, typename Allocator>
+const typename BlockLinearSystem<T, Allocator>::Vector&
+BlockLinearSystem<T, Allocator>::reordered_matrix(
+    Ordering ordering, std::size_t nblocks) {
+  if (ordering != Ordering::Natural)
+    this->reorder(make_permutation(ordering, nblocks, this->nrows_, this->A_));
+  return this->A_;
+}
+
 } // namespace ex_m_thr
 
 #endif // EXAMPLE_BLOCK_LINEAR_SYSTEM_H_
\ No newline at end of file
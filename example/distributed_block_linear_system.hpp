@@ -0,0 +1,284 @@
+// Copyright (C) 2018 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A_ PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef EXAMPLE_DISTRIBUTED_BLOCK_LINEAR_SYSTEM_H_
+#define EXAMPLE_DISTRIBUTED_BLOCK_LINEAR_SYSTEM_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "block_jacobi.hpp"
+#include "transport.hpp"
+
+namespace ex_m_thr {
+
+// Block Jacobi over processes: the rank k owns the k-th BlockJacobi block of
+// rows and stores only these rows of A. Every step exchanges the values of
+// lhs coupled to other blocks and all-reduces the convergence norms.
+template <typename T = float>
+class DistributedBlockLinearSystem {
+public:
+  // A and rhs are the rows [first_row(), last_row()) of the whole system,
+  // the rows are split as block_offsets(nrows, transport.size()).
+  DistributedBlockLinearSystem<T>(
+    Transport& transport,
+    std::size_t max_steps,
+    T accuracy,
+    std::size_t nrows,
+    const std::vector<T>& A,
+    const std::vector<T>& rhs);
+
+  std::size_t first_row() const;
+  std::size_t last_row() const;
+
+  // The own rows of the solution.
+  std::vector<T> solution() const;
+
+  std::size_t nsteps() const;
+  std::vector<T> r_residual_norms() const;
+
+  void solve();
+
+private:
+  void setup_halo();
+  std::vector<T> step_solution_gauss_seidel();
+  bool is_convergence(const std::vector<T>& lhs_new);
+
+  Transport& transport_;
+
+  const std::size_t max_steps_;
+  const T accuracy_;
+
+  std::vector<T> r_residual_norms_;
+
+  const std::size_t nrows_;
+  std::vector<std::size_t> offsets_;
+  std::size_t at_;
+  std::size_t to_;
+
+  // (to_ - at_) x nrows_
+  std::vector<T> A_;
+  std::vector<T> lhs_;
+  std::vector<T> rhs_;
+
+  // Columns of other blocks coupled to the own rows, grouped by the owner:
+  // the rank p sends halo_cols_[halo_offsets_[p], halo_offsets_[p + 1]).
+  std::vector<std::size_t> halo_cols_;
+  std::vector<std::size_t> halo_offsets_;
+  std::vector<T> halo_;
+
+  // Own rows (local indices) wanted by other ranks, grouped the same way.
+  std::vector<std::size_t> send_rows_;
+  std::vector<std::size_t> send_offsets_;
+  std::vector<T> send_;
+};
+
+template <typename T>
+DistributedBlockLinearSystem<T>::DistributedBlockLinearSystem(
+    Transport& transport,
+    std::size_t max_steps,
+    T accuracy,
+    std::size_t nrows,
+    const std::vector<T>& A,
+    const std::vector<T>& rhs)
+  : transport_(transport),
+    max_steps_(max_steps),
+    accuracy_(accuracy),
+    nrows_(nrows),
+    offsets_(block_offsets(nrows, transport.size())),
+    at_(offsets_[transport.rank()]),
+    to_(offsets_[transport.rank() + 1]),
+    A_(A),
+    lhs_(to_ - at_),
+    rhs_(rhs) {
+  if (A_.size() != (to_ - at_) * nrows_ || rhs_.size() != to_ - at_)
+    throw std::runtime_error(
+      "DistributedBlockLinearSystem: A and rhs must hold the own rows only!");
+
+  r_residual_norms_.reserve(max_steps_);
+  setup_halo();
+}
+
+template <typename T>
+std::size_t DistributedBlockLinearSystem<T>::first_row() const { return at_; }
+
+template <typename T>
+std::size_t DistributedBlockLinearSystem<T>::last_row() const { return to_; }
+
+template <typename T>
+std::vector<T> DistributedBlockLinearSystem<T>::solution() const { return lhs_; }
+
+template <typename T>
+std::size_t DistributedBlockLinearSystem<T>::nsteps() const {
+  return r_residual_norms_.size();
+}
+
+template <typename T>
+std::vector<T> DistributedBlockLinearSystem<T>::r_residual_norms() const {
+  return r_residual_norms_;
+}
+
+template <typename T>
+void DistributedBlockLinearSystem<T>::setup_halo() {
+  const std::size_t me = transport_.rank();
+  const std::size_t nprocs = transport_.size();
+  const std::size_t nlocal = to_ - at_;
+
+  halo_offsets_.assign(nprocs + 1, 0);
+  for (std::size_t p = 0; p < nprocs; ++p) {
+    if (p != me)
+      for (std::size_t j = offsets_[p]; j < offsets_[p + 1]; ++j)
+        for (std::size_t i = 0; i < nlocal; ++i)
+          if (A_[i * nrows_ + j] != T(0)) {
+            halo_cols_.push_back(j);
+            break;
+          }
+    halo_offsets_[p + 1] = halo_cols_.size();
+  }
+  halo_.resize(halo_cols_.size());
+
+  // Every rank tells the owners which of their rows it needs.
+  std::vector<std::uint64_t> want_counts(nprocs), send_counts(nprocs);
+  std::vector<std::future<void>> requests;
+  for (std::size_t p = 0; p < nprocs; ++p)
+    if (p != me) {
+      want_counts[p] = halo_offsets_[p + 1] - halo_offsets_[p];
+      requests.push_back(
+        transport_.isend(p, &want_counts[p], sizeof(std::uint64_t)));
+      requests.push_back(
+        transport_.irecv(p, &send_counts[p], sizeof(std::uint64_t)));
+    }
+  for (auto& request : requests)
+    request.get();
+  requests.clear();
+
+  send_offsets_.assign(nprocs + 1, 0);
+  for (std::size_t p = 0; p < nprocs; ++p)
+    send_offsets_[p + 1] = send_offsets_[p] + send_counts[p];
+
+  std::vector<std::uint64_t> want(halo_cols_.begin(), halo_cols_.end());
+  std::vector<std::uint64_t> wanted(send_offsets_[nprocs]);
+  for (std::size_t p = 0; p < nprocs; ++p) {
+    if (want_counts[p] > 0)
+      requests.push_back(transport_.isend(
+        p, &want[halo_offsets_[p]], want_counts[p] * sizeof(std::uint64_t)));
+    if (send_counts[p] > 0)
+      requests.push_back(transport_.irecv(
+        p, &wanted[send_offsets_[p]], send_counts[p] * sizeof(std::uint64_t)));
+  }
+  for (auto& request : requests)
+    request.get();
+
+  send_rows_.reserve(wanted.size());
+  for (std::uint64_t j : wanted) {
+    if (j < at_ || j >= to_)
+      throw std::runtime_error("DistributedBlockLinearSystem: wrong halo!");
+    send_rows_.push_back(j - at_);
+  }
+  send_.resize(send_rows_.size());
+}
+
+template <typename T>
+void DistributedBlockLinearSystem<T>::solve() {
+  std::vector<T> lhs_new;
+  for (std::size_t i = 0; i < max_steps_; ++i) {
+    lhs_new = step_solution_gauss_seidel();
+    bool is_stop = is_convergence(lhs_new);
+    lhs_ = lhs_new;
+    if (is_stop)
+      break;
+  }
+
+  if (r_residual_norms_.size() == max_steps_ && transport_.rank() == 0)
+    std::cerr << "Warning! Solve: steps == max_steps_" << std::endl;
+}
+
+// The halo exchange is in flight while the part of the sweep that needs
+// only own values is computed.
+template <typename T>
+std::vector<T> DistributedBlockLinearSystem<T>::step_solution_gauss_seidel() {
+  const std::size_t nprocs = transport_.size();
+  const std::size_t nlocal = to_ - at_;
+
+  for (std::size_t k = 0; k < send_rows_.size(); ++k)
+    send_[k] = lhs_[send_rows_[k]];
+
+  std::vector<std::future<void>> sends, recvs;
+  for (std::size_t p = 0; p < nprocs; ++p) {
+    if (send_offsets_[p + 1] > send_offsets_[p])
+      sends.push_back(transport_.isend(p, &send_[send_offsets_[p]],
+        (send_offsets_[p + 1] - send_offsets_[p]) * sizeof(T)));
+    if (halo_offsets_[p + 1] > halo_offsets_[p])
+      recvs.push_back(transport_.irecv(p, &halo_[halo_offsets_[p]],
+        (halo_offsets_[p + 1] - halo_offsets_[p]) * sizeof(T)));
+  }
+
+  std::vector<T> lhs_new(rhs_);
+  for (std::size_t i = 0; i < nlocal; ++i)
+    for (std::size_t j = i + 1; j < nlocal; ++j)
+      lhs_new[i] -= A_[i * nrows_ + at_ + j] * lhs_[j];
+
+  for (auto& recv : recvs)
+    recv.get();
+
+  for (std::size_t i = 0; i < nlocal; ++i) {
+    for (std::size_t k = 0; k < halo_cols_.size(); ++k)
+      lhs_new[i] -= A_[i * nrows_ + halo_cols_[k]] * halo_[k];
+
+    for (std::size_t j = 0; j < i; ++j)
+      lhs_new[i] -= A_[i * nrows_ + at_ + j] * lhs_new[j];
+
+    lhs_new[i] /= A_[i * nrows_ + at_ + i];
+  }
+
+  for (auto& send : sends)
+    send.get();
+
+  return lhs_new;
+}
+
+template <typename T>
+bool DistributedBlockLinearSystem<T>::is_convergence(
+    const std::vector<T>& lhs_new) {
+  std::vector<double> norms(2, 0.0);
+  for (std::size_t i = 0; i < lhs_new.size(); ++i) {
+    T d = lhs_new[i] - lhs_[i];
+    norms[0] += d * d;
+    norms[1] += lhs_new[i] * lhs_new[i];
+  }
+  transport_.allreduce_sum(norms);
+
+  T r_residual_norm = static_cast<T>(std::sqrt(norms[0] / norms[1]));
+  r_residual_norms_.push_back(r_residual_norm);
+
+  return r_residual_norm <= accuracy_;
+}
+
+} // namespace ex_m_thr
+
+#endif // EXAMPLE_DISTRIBUTED_BLOCK_LINEAR_SYSTEM_H_
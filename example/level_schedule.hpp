@@ -0,0 +1,247 @@
+// Copyright (C) 2018 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A_ PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef EXAMPLE_LEVEL_SCHEDULE_H_
+#define EXAMPLE_LEVEL_SCHEDULE_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace ex_m_thr {
+
+class Barrier {
+public:
+  explicit Barrier(std::size_t count) : count_(count), waiting_(0) {}
+
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const std::size_t generation = generation_;
+    if (++waiting_ == count_) {
+      waiting_ = 0;
+      ++generation_;
+      cv_.notify_all();
+    } else {
+      cv_.wait(lock, [this, generation] { return generation != generation_; });
+    }
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  const std::size_t count_;
+  std::size_t waiting_;
+  std::size_t generation_ {0};
+};
+
+// Wavefronts of the forward Gauss-Seidel sweep over the rows [at, to):
+// the row i depends on the rows at <= j < i with a_ij != 0, the rows of
+// the same level are independent and are updated concurrently.
+template <typename T = float>
+class LevelSchedule {
+public:
+  LevelSchedule<T>();
+  ~LevelSchedule<T>();
+  LevelSchedule<T>(const LevelSchedule<T>&);
+  LevelSchedule<T>(LevelSchedule<T>&&);
+  LevelSchedule<T>& operator=(const LevelSchedule<T>&);
+  LevelSchedule<T>& operator=(LevelSchedule<T>&&);
+
+  template <typename Allocator>
+  LevelSchedule<T>(
+    std::size_t nrows,
+    const std::vector<T, Allocator>& A,
+    std::size_t at,
+    std::size_t to);
+
+  bool empty() const;
+  std::size_t nlevels() const;
+  std::vector<std::size_t> level(std::size_t k) const;
+
+  // It pays to start nthreads only if the levels are wide enough.
+  bool is_parallel(std::size_t nthreads) const;
+
+  // x[i - at] = (x[i - at] - sum_{j < at} a_ij lhs_j - sum_{at <= j < i} a_ij x[j - at]
+  //             - sum_{j > i} a_ij lhs_j) / a_ii, x is initialized with rhs.
+  template <typename Allocator>
+  void step_solution_gauss_seidel(
+    const std::vector<T, Allocator>& A,
+    const std::vector<T, Allocator>& lhs,
+    T* x,
+    std::size_t nthreads) const;
+
+private:
+  template <typename Allocator>
+  void step_solution_gauss_seidel_thr(
+    const std::vector<T, Allocator>& A,
+    const std::vector<T, Allocator>& lhs,
+    T* x,
+    std::size_t nthreads,
+    std::size_t thr_id,
+    Barrier& barrier) const;
+
+  std::size_t nrows_ {0};
+  std::size_t at_ {0};
+  std::size_t to_ {0};
+
+  // Rows sorted by level, level k is rows_[level_offsets_[k], level_offsets_[k + 1]).
+  std::vector<std::size_t> rows_;
+  std::vector<std::size_t> level_offsets_;
+};
+
+template <typename T>
+LevelSchedule<T>::LevelSchedule() = default;
+
+template <typename T>
+LevelSchedule<T>::~LevelSchedule() = default;
+
+template <typename T>
+LevelSchedule<T>::LevelSchedule(const LevelSchedule<T>&) = default;
+
+template <typename T>
+LevelSchedule<T>::LevelSchedule(LevelSchedule<T>&&) = default;
+
+template <typename T>
+LevelSchedule<T>& LevelSchedule<T>::operator=(const LevelSchedule<T>&) = default;
+
+template <typename T>
+LevelSchedule<T>& LevelSchedule<T>::operator=(LevelSchedule<T>&&) = default;
+
+template <typename T>
+template <typename Allocator>
+LevelSchedule<T>::LevelSchedule(
+    std::size_t nrows,
+    const std::vector<T, Allocator>& A,
+    std::size_t at,
+    std::size_t to)
+  : nrows_(nrows), at_(at), to_(to) {
+  if (A.size() != nrows * nrows || at > to || to > nrows)
+    throw std::runtime_error("LevelSchedule: wrong range!");
+
+  std::vector<std::size_t> level(to_ - at_, 0);
+  std::size_t nlevels {0};
+  for (std::size_t i = at_; i < to_; ++i) {
+    std::size_t l {0};
+    for (std::size_t j = at_; j < i; ++j)
+      if (A[i * nrows_ + j] != T(0))
+        l = std::max(l, level[j - at_] + 1);
+    level[i - at_] = l;
+    nlevels = std::max(nlevels, l + 1);
+  }
+
+  // Counting sort of the rows by level.
+  level_offsets_.assign(nlevels + 1, 0);
+  for (std::size_t l : level)
+    ++level_offsets_[l + 1];
+  for (std::size_t k = 0; k < nlevels; ++k)
+    level_offsets_[k + 1] += level_offsets_[k];
+
+  rows_.resize(to_ - at_);
+  std::vector<std::size_t> pos(level_offsets_.begin(), level_offsets_.end() - 1);
+  for (std::size_t i = at_; i < to_; ++i)
+    rows_[pos[level[i - at_]]++] = i;
+}
+
+template <typename T>
+bool LevelSchedule<T>::empty() const { return rows_.empty(); }
+
+template <typename T>
+std::size_t LevelSchedule<T>::nlevels() const {
+  return level_offsets_.empty() ? 0 : level_offsets_.size() - 1;
+}
+
+template <typename T>
+std::vector<std::size_t> LevelSchedule<T>::level(std::size_t k) const {
+  return std::vector<std::size_t>(
+    rows_.begin() + level_offsets_[k], rows_.begin() + level_offsets_[k + 1]);
+}
+
+template <typename T>
+bool LevelSchedule<T>::is_parallel(std::size_t nthreads) const {
+  return nthreads > 1 && !empty() && rows_.size() >= nthreads * nlevels();
+}
+
+template <typename T>
+template <typename Allocator>
+void LevelSchedule<T>::step_solution_gauss_seidel(
+    const std::vector<T, Allocator>& A,
+    const std::vector<T, Allocator>& lhs,
+    T* x,
+    std::size_t nthreads) const {
+  nthreads = std::max<std::size_t>(nthreads, 1);
+  Barrier barrier(nthreads);
+
+  std::vector<std::thread> threads;
+  for (std::size_t k = 1; k < nthreads; ++k) {
+    std::thread thr([&A, &lhs, x, nthreads, k, &barrier, this] {
+      step_solution_gauss_seidel_thr(A, lhs, x, nthreads, k, barrier);
+    });
+    threads.emplace_back(std::move(thr));
+  }
+  step_solution_gauss_seidel_thr(A, lhs, x, nthreads, 0, barrier);
+
+  for(auto& thr : threads)
+    thr.join();
+}
+
+template <typename T>
+template <typename Allocator>
+void LevelSchedule<T>::step_solution_gauss_seidel_thr(
+    const std::vector<T, Allocator>& A,
+    const std::vector<T, Allocator>& lhs,
+    T* x,
+    std::size_t nthreads,
+    std::size_t thr_id,
+    Barrier& barrier) const {
+  for (std::size_t k = 0; k + 1 < level_offsets_.size(); ++k) {
+    for (std::size_t r = level_offsets_[k] + thr_id;
+         r < level_offsets_[k + 1]; r += nthreads) {
+      const std::size_t i = rows_[r];
+      const T* a = &A[i * nrows_];
+      T xi = x[i - at_];
+
+      for (std::size_t j = 0; j < at_; ++j)
+        xi -= a[j] * lhs[j];
+
+      // Rows of the current and later levels may be written concurrently,
+      // all of them have a_ij == 0 here.
+      for (std::size_t j = at_; j < i; ++j)
+        if (a[j] != T(0))
+          xi -= a[j] * x[j - at_];
+
+      for (std::size_t j = i + 1; j < nrows_; ++j)
+        xi -= a[j] * lhs[j];
+
+      x[i - at_] = xi / a[i];
+    }
+
+    barrier.wait();
+  }
+}
+
+} // namespace ex_m_thr
+
+#endif // EXAMPLE_LEVEL_SCHEDULE_H_
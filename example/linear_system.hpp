@@ -25,145 +25,202 @@
 
 #include <cmath>
 #include <initializer_list>
+#include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
+#include "level_schedule.hpp"
+#include "reordering.hpp"
+#include "thread_pool.hpp"
+
 namespace ex_m_thr {
 
 enum class Method {
   GaussSeidel,
-  SOR
+  SOR,
+  SymmetricGaussSeidel,
+  SSOR
 };
 
-template <typename T = float>
+template <typename T = float, typename Allocator = std::allocator<T>>
 class LinearSystem {
 public:
-  LinearSystem<T>();
-  virtual ~LinearSystem<T>();
-  LinearSystem<T>(const LinearSystem<T>&);
-  LinearSystem<T>(LinearSystem<T>&&);
-  LinearSystem<T>& operator=(const LinearSystem<T>&);
-  LinearSystem<T>& operator=(LinearSystem<T>&&);
-
-  LinearSystem<T>(
+  using Vector = std::vector<T, Allocator>;
+
+  LinearSystem<T, Allocator>();
+  virtual ~LinearSystem<T, Allocator>();
+  LinearSystem<T, Allocator>(const LinearSystem<T, Allocator>&);
+  LinearSystem<T, Allocator>(LinearSystem<T, Allocator>&&);
+  LinearSystem<T, Allocator>& operator=(const LinearSystem<T, Allocator>&);
+  LinearSystem<T, Allocator>& operator=(LinearSystem<T, Allocator>&&);
+
+  LinearSystem<T, Allocator>(
     std::size_t max_steps,
     T accuracy,
     std::size_t nrows,
     const std::vector<T>& A,
-    const std::vector<T>& rhs);
+    const std::vector<T>& rhs,
+    std::size_t nthreads = 1,
+    const Allocator& alloc = Allocator());
 
-  LinearSystem<T>(
+  LinearSystem<T, Allocator>(
     std::size_t max_steps,
     T accuracy,
     std::size_t nrows,
     std::initializer_list<T> A,
-    std::initializer_list<T> rhs);
+    std::initializer_list<T> rhs,
+    std::size_t nthreads = 1,
+    const Allocator& alloc = Allocator());
 
   std::vector<T> solution() const;
+  std::size_t nrows() const;
 
   std::size_t nsteps() const;
   std::vector<T> r_residual_norms() const;
 
   void solve(Method method = Method::GaussSeidel);
 
+  // Parallel sweeps run on the pool instead of own threads.
+  virtual void set_thread_pool(ThreadPool* pool);
+
 protected:
-  virtual std::vector<T> step_solution_gauss_seidel();
-  virtual std::vector<T> step_solution_sor(T w = 0.5);
-  bool is_convergence(const std::vector<T>& lhs_new);
+  virtual Vector step_solution_gauss_seidel();
+  virtual Vector step_solution_sor(T w = 0.5);
+  virtual Vector step_solution_symmetric_gauss_seidel();
+  virtual Vector step_solution_ssor(T w = 0.5);
+  bool is_convergence(const Vector& lhs_new);
+  void reorder(const std::vector<std::size_t>& perm);
 
   const std::size_t max_steps_;
   const T accuracy_;
 
-  std::vector<T> r_residual_norms_;
+  // All vectors and the per-step lhs_new are taken from the allocator,
+  // see ArenaAllocator.
+  Vector r_residual_norms_;
 
   const std::size_t nrows_;
   const std::size_t ncols_;
 
-  std::vector<T> A_;
-  std::vector<T> lhs_;
-  std::vector<T> rhs_;
+  Vector A_;
+  Vector lhs_;
+  Vector rhs_;
+
+  // Empty for the natural ordering, otherwise perm_[i] is the original
+  // index of the row i of A_.
+  std::vector<std::size_t> perm_;
+
+  // Gauss-Seidel sweeps use nthreads_ threads over the levels of schedule_,
+  // if the sparsity of A_ allows it.
+  const std::size_t nthreads_;
+  LevelSchedule<T> schedule_;
+
+  ThreadPool* pool_ {nullptr};
 };
 
 // Пример из https://s-mat-pcs.oulu.fi/~mpa/matreng/eem5_4-1.htm
-template <typename T>
-LinearSystem<T>::LinearSystem()
+template <typename T, typename Allocator>
+LinearSystem<T, Allocator>::LinearSystem()
   : max_steps_(100),
     accuracy_(1.0e-6),
     nrows_(3),
     ncols_(nrows_),
     A_({4.0,  1.0, -1.0, 2.0,  7.0,  1.0, 1.0, -3.0, 12.0}),
     lhs_(nrows_),
-    rhs_({3.0, 19.0, 31.0}) {
+    rhs_({3.0, 19.0, 31.0}),
+    nthreads_(1) {
   r_residual_norms_.reserve(max_steps_);
 };
 
-template <typename T>
-LinearSystem<T>::LinearSystem(
+template <typename T, typename Allocator>
+LinearSystem<T, Allocator>::LinearSystem(
     std::size_t max_steps,
     T accuracy,
     std::size_t nrows,
     const std::vector<T>& A,
-    const std::vector<T>& rhs)
+    const std::vector<T>& rhs,
+    std::size_t nthreads,
+    const Allocator& alloc)
   : max_steps_(max_steps),
     accuracy_(accuracy),
+    r_residual_norms_(alloc),
     nrows_(nrows),
     ncols_(nrows),
-    A_(A),
-    lhs_(nrows),
-    rhs_(rhs) {
+    A_(A.begin(), A.end(), alloc),
+    lhs_(nrows, alloc),
+    rhs_(rhs.begin(), rhs.end(), alloc),
+    nthreads_(nthreads) {
   r_residual_norms_.reserve(max_steps_);
 };
 
-template <typename T>
-LinearSystem<T>::LinearSystem(
+template <typename T, typename Allocator>
+LinearSystem<T, Allocator>::LinearSystem(
     std::size_t max_steps,
     T accuracy,
     std::size_t nrows,
     std::initializer_list<T> A,
-    std::initializer_list<T> rhs)
+    std::initializer_list<T> rhs,
+    std::size_t nthreads,
+    const Allocator& alloc)
   : max_steps_(max_steps),
     accuracy_(accuracy),
+    r_residual_norms_(alloc),
     nrows_(nrows),
     ncols_(nrows),
-    A_(A),
-    lhs_(nrows),
-    rhs_(rhs) {
+    A_(A, alloc),
+    lhs_(nrows, alloc),
+    rhs_(rhs, alloc),
+    nthreads_(nthreads) {
   r_residual_norms_.reserve(max_steps_);
 };
 
-template <typename T>
-LinearSystem<T>::~LinearSystem() = default;
+template <typename T, typename Allocator>
+LinearSystem<T, Allocator>::~LinearSystem() = default;
 
-template <typename T>
-LinearSystem<T>::LinearSystem(const LinearSystem<T>&) = default;
+template <typename T, typename Allocator>
+LinearSystem<T, Allocator>::LinearSystem(
+    const LinearSystem<T, Allocator>&) = default;
 
-template <typename T>
-LinearSystem<T>::LinearSystem(LinearSystem<T>&&) = default;
+template <typename T, typename Allocator>
+LinearSystem<T, Allocator>::LinearSystem(
+    LinearSystem<T, Allocator>&&) = default;
 
-template <typename T>
-LinearSystem<T>& LinearSystem<T>::operator=(const LinearSystem<T>&) = default;
+template <typename T, typename Allocator>
+LinearSystem<T, Allocator>&
+LinearSystem<T, Allocator>::operator=(const LinearSystem<T, Allocator>&) = default;
 
-template <typename T>
-LinearSystem<T>& LinearSystem<T>::operator=(LinearSystem<T>&&) = default;
+template <typename T, typename Allocator>
+LinearSystem<T, Allocator>&
+LinearSystem<T, Allocator>::operator=(LinearSystem<T, Allocator>&&) = default;
 
-template <typename T>
-std::vector<T> LinearSystem<T>::solution() const { return lhs_; }
+template <typename T, typename Allocator>
+std::vector<T> LinearSystem<T, Allocator>::solution() const {
+  if (perm_.empty())
+    return std::vector<T>(lhs_.begin(), lhs_.end());
+  return unpermute_vector(lhs_, perm_);
+}
 
-template <typename T>
-std::size_t LinearSystem<T>::nsteps() const { r_residual_norms_.size(); }
+template <typename T, typename Allocator>
+std::size_t LinearSystem<T, Allocator>::nrows() const { return nrows_; }
 
-template <typename T>
-std::vector<T> LinearSystem<T>::r_residual_norms() const {
-  return r_residual_norms_;
+template <typename T, typename Allocator>
+std::size_t LinearSystem<T, Allocator>::nsteps() const { return r_residual_norms_.size(); }
+
+template <typename T, typename Allocator>
+std::vector<T> LinearSystem<T, Allocator>::r_residual_norms() const {
+  return std::vector<T>(r_residual_norms_.begin(), r_residual_norms_.end());
 }
 
-template <typename T>
-void LinearSystem<T>::solve(Method method) {
-  std::vector<T> lhs_new;
+template <typename T, typename Allocator>
+void LinearSystem<T, Allocator>::solve(Method method) {
+  Vector lhs_new(lhs_.get_allocator());
   for (std::size_t i = 0; i < max_steps_; ++i) {
     switch (method) {
       case Method::GaussSeidel: lhs_new = step_solution_gauss_seidel(); break;
       case Method::SOR:         lhs_new = step_solution_sor(); break;
+      case Method::SymmetricGaussSeidel:
+        lhs_new = step_solution_symmetric_gauss_seidel(); break;
+      case Method::SSOR:        lhs_new = step_solution_ssor(); break;
       default:
         throw std::runtime_error("Solve: undefined method!");
     }
@@ -177,9 +234,23 @@ void LinearSystem<T>::solve(Method method) {
     std::cerr << "Warning! Solve: steps == max_steps_" << std::endl;
 }
 
-template <typename T>
-std::vector<T> LinearSystem<T>::step_solution_gauss_seidel() {
-  std::vector<T> lhs_new(rhs_);
+template <typename T, typename Allocator>
+void LinearSystem<T, Allocator>::set_thread_pool(ThreadPool* pool) { pool_ = pool; }
+
+template <typename T, typename Allocator>
+typename LinearSystem<T, Allocator>::Vector
+LinearSystem<T, Allocator>::step_solution_gauss_seidel() {
+  Vector lhs_new(rhs_);
+
+  // The level sweep starts own threads, it is not used on a shared pool.
+  if (nthreads_ > 1 && pool_ == nullptr) {
+    if (schedule_.empty())
+      schedule_ = LevelSchedule<T>(nrows_, A_, 0, nrows_);
+    if (schedule_.is_parallel(nthreads_)) {
+      schedule_.step_solution_gauss_seidel(A_, lhs_, lhs_new.data(), nthreads_);
+      return lhs_new;
+    }
+  }
 
   for (std::size_t i = 0; i < nrows_; ++i) {
     for (std::size_t j = 0; j < i; ++j)
@@ -194,9 +265,10 @@ std::vector<T> LinearSystem<T>::step_solution_gauss_seidel() {
   return lhs_new;
 }
 
-template <typename T>
-std::vector<T> LinearSystem<T>::step_solution_sor(T w) {
-  std::vector<T> lhs_new(rhs_);
+template <typename T, typename Allocator>
+typename LinearSystem<T, Allocator>::Vector
+LinearSystem<T, Allocator>::step_solution_sor(T w) {
+  Vector lhs_new(rhs_);
 
   for (std::size_t i = 0; i < nrows_; ++i) {
     for (std::size_t j = 0; j < i; ++j)
@@ -212,8 +284,41 @@ std::vector<T> LinearSystem<T>::step_solution_sor(T w) {
   return lhs_new;
 }
 
-template <typename T>
-bool LinearSystem<T>::is_convergence(const std::vector<T>& lhs_new) {
+template <typename T, typename Allocator>
+typename LinearSystem<T, Allocator>::Vector
+LinearSystem<T, Allocator>::step_solution_symmetric_gauss_seidel() {
+  return step_solution_ssor(T(1));
+}
+
+// Forward and backward SOR sweeps in place: the backward sweep starts from
+// the rows the forward sweep has just left in cache.
+template <typename T, typename Allocator>
+typename LinearSystem<T, Allocator>::Vector
+LinearSystem<T, Allocator>::step_solution_ssor(T w) {
+  Vector lhs_new(lhs_);
+
+  auto update = [this, &lhs_new, w](std::size_t i) {
+    T r = rhs_[i];
+    for (std::size_t j = 0; j < i; ++j)
+      r -= A_[i * nrows_ + j] * lhs_new[j];
+
+    for (std::size_t j = i + 1; j < ncols_; ++j)
+      r -= A_[i * nrows_ + j] * lhs_new[j];
+
+    lhs_new[i] += w * (r / A_[i * nrows_ + i] - lhs_new[i]);
+  };
+
+  for (std::size_t i = 0; i < nrows_; ++i)
+    update(i);
+
+  for (std::size_t i = nrows_; i-- > 0;)
+    update(i);
+
+  return lhs_new;
+}
+
+template <typename T, typename Allocator>
+bool LinearSystem<T, Allocator>::is_convergence(const Vector& lhs_new) {
   T dd {0.0};
   T xx {0.0};
   for (std::size_t i = 0; i < nrows_; ++i) {
@@ -228,6 +333,23 @@ bool LinearSystem<T>::is_convergence(const std::vector<T>& lhs_new) {
   return r_residual_norm <= accuracy_;
 }
 
+template <typename T, typename Allocator>
+void LinearSystem<T, Allocator>::reorder(const std::vector<std::size_t>& perm) {
+  if (perm.size() != nrows_)
+    throw std::runtime_error("reorder: perm.size() != nrows_!");
+
+  A_ = permute_matrix(nrows_, A_, perm);
+  schedule_ = LevelSchedule<T>();
+  lhs_ = permute_vector(lhs_, perm);
+  rhs_ = permute_vector(rhs_, perm);
+
+  if (perm_.empty()) {
+    perm_ = perm;
+  } else {
+    perm_ = permute_vector(perm_, perm);
+  }
+}
+
 } // namespace ex_m_thr
 
 #endif // EXAMPLE_LINEAR_SYSTEM_H_
\ No newline at end of file
@@ -0,0 +1,274 @@
+// Copyright (C) 2018 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef EXAMPLE_REORDERING_H_
+#define EXAMPLE_REORDERING_H_
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace ex_m_thr {
+
+enum class Ordering {
+  Natural,
+  RCM,
+  Partition
+};
+
+// Symmetric sparsity pattern of the dense matrix A (without the diagonal).
+template <typename T = float, typename Allocator = std::allocator<T>>
+std::vector<std::vector<std::size_t>> adjacency(
+    std::size_t nrows, const std::vector<T, Allocator>& A) {
+  if (A.size() != nrows * nrows)
+    throw std::runtime_error("adjacency: A.size() != nrows * nrows!");
+
+  std::vector<std::vector<std::size_t>> adj(nrows);
+  for (std::size_t i = 0; i < nrows; ++i)
+    for (std::size_t j = i + 1; j < nrows; ++j)
+      if (A[i * nrows + j] != T(0) || A[j * nrows + i] != T(0)) {
+        adj[i].push_back(j);
+        adj[j].push_back(i);
+      }
+
+  return adj;
+}
+
+template <typename T = float, typename Allocator = std::allocator<T>>
+std::size_t bandwidth(std::size_t nrows, const std::vector<T, Allocator>& A) {
+  std::size_t bw {0};
+  for (std::size_t i = 0; i < nrows; ++i)
+    for (std::size_t j = 0; j < nrows; ++j)
+      if (A[i * nrows + j] != T(0))
+        bw = std::max(bw, i > j ? i - j : j - i);
+
+  return bw;
+}
+
+// B[i][j] = A[perm[i]][perm[j]], perm[i] is the old index of the new row i.
+template <typename T = float, typename Allocator = std::allocator<T>>
+std::vector<T, Allocator> permute_matrix(
+    std::size_t nrows,
+    const std::vector<T, Allocator>& A,
+    const std::vector<std::size_t>& perm) {
+  std::vector<T, Allocator> B(nrows * nrows, A.get_allocator());
+  for (std::size_t i = 0; i < nrows; ++i)
+    for (std::size_t j = 0; j < nrows; ++j)
+      B[i * nrows + j] = A[perm[i] * nrows + perm[j]];
+
+  return B;
+}
+
+template <typename T = float, typename Allocator = std::allocator<T>>
+std::vector<T, Allocator> permute_vector(
+    const std::vector<T, Allocator>& v, const std::vector<std::size_t>& perm) {
+  std::vector<T, Allocator> result(v.get_allocator());
+  result.reserve(perm.size());
+  for (std::size_t i : perm)
+    result.push_back(v[i]);
+
+  return result;
+}
+
+template <typename T = float, typename Allocator = std::allocator<T>>
+std::vector<T> unpermute_vector(
+    const std::vector<T, Allocator>& v, const std::vector<std::size_t>& perm) {
+  std::vector<T> result(perm.size());
+  for (std::size_t i = 0; i < perm.size(); ++i)
+    result[perm[i]] = v[i];
+
+  return result;
+}
+
+// Reverse Cuthill-McKee, every connected component is started from
+// a pseudo-peripheral vertex (George-Liu).
+inline std::vector<std::size_t> reverse_cuthill_mckee(
+    const std::vector<std::vector<std::size_t>>& adj) {
+  const std::size_t nrows = adj.size();
+  std::vector<std::size_t> order;
+  order.reserve(nrows);
+  std::vector<bool> visited(nrows, false);
+  std::vector<std::size_t> level(nrows);
+
+  auto by_degree = [&adj](std::size_t a, std::size_t b) {
+    return adj[a].size() < adj[b].size()
+      || (adj[a].size() == adj[b].size() && a < b);
+  };
+
+  // Returns the vertices of the last BFS level and the eccentricity of root.
+  auto bfs_last_level = [&adj, &level, &visited](std::size_t root) {
+    std::vector<std::size_t> current {root}, last;
+    std::vector<std::size_t> touched {root};
+    std::size_t depth {0};
+    level[root] = 1;
+    while (!current.empty()) {
+      last = current;
+      std::vector<std::size_t> next;
+      for (std::size_t v : current)
+        for (std::size_t u : adj[v])
+          if (!visited[u] && level[u] == 0) {
+            level[u] = 1;
+            next.push_back(u);
+            touched.push_back(u);
+          }
+      current = std::move(next);
+      ++depth;
+    }
+    for (std::size_t v : touched)
+      level[v] = 0;
+    return std::make_pair(last, depth);
+  };
+
+  for (std::size_t seed = 0; seed < nrows; ++seed) {
+    if (visited[seed])
+      continue;
+
+    std::size_t root = seed;
+    auto [last, depth] = bfs_last_level(root);
+    for (;;) {
+      std::size_t candidate =
+        *std::min_element(last.begin(), last.end(), by_degree);
+      auto [c_last, c_depth] = bfs_last_level(candidate);
+      if (c_depth <= depth)
+        break;
+      root = candidate;
+      last = std::move(c_last);
+      depth = c_depth;
+    }
+
+    const std::size_t begin = order.size();
+    order.push_back(root);
+    visited[root] = true;
+    for (std::size_t k = begin; k < order.size(); ++k) {
+      std::vector<std::size_t> next;
+      for (std::size_t u : adj[order[k]])
+        if (!visited[u]) {
+          visited[u] = true;
+          next.push_back(u);
+        }
+      std::sort(next.begin(), next.end(), by_degree);
+      order.insert(order.end(), next.begin(), next.end());
+    }
+  }
+
+  std::reverse(order.begin(), order.end());
+  return order;
+}
+
+template <typename T = float, typename Allocator = std::allocator<T>>
+std::vector<std::size_t> reverse_cuthill_mckee(
+    std::size_t nrows, const std::vector<T, Allocator>& A) {
+  return reverse_cuthill_mckee(adjacency(nrows, A));
+}
+
+// Splits the graph of A into nblocks parts with the same sizes as
+// the BlockJacobi row ranges. Parts are grown greedily from the first free
+// vertex of the RCM order, always taking the frontier vertex with the largest
+// coupling |a_ij| + |a_ji| to the part. Inside a part the RCM order is kept.
+template <typename T = float, typename Allocator = std::allocator<T>>
+std::vector<std::size_t> partition_graph(
+    std::size_t nblocks, std::size_t nrows, const std::vector<T, Allocator>& A) {
+  if (nblocks == 0 || nblocks > nrows)
+    throw std::runtime_error("partition_graph: wrong nblocks!");
+
+  const auto adj = adjacency(nrows, A);
+  const auto rcm = reverse_cuthill_mckee(adj);
+  std::vector<std::size_t> rank(nrows);
+  for (std::size_t i = 0; i < nrows; ++i)
+    rank[rcm[i]] = i;
+
+  const std::size_t offset = nrows / nblocks;
+  const std::size_t balance = nrows - offset * nblocks;
+
+  constexpr std::size_t free_part = static_cast<std::size_t>(-1);
+  std::vector<std::size_t> part(nrows, free_part);
+  std::vector<T> conn(nrows, T(0));
+  std::size_t next_seed {0};
+
+  std::vector<std::size_t> perm;
+  perm.reserve(nrows);
+  for (std::size_t k = 0; k < nblocks; ++k) {
+    const std::size_t size = offset + (k < balance ? 1 : 0);
+    const std::size_t begin = perm.size();
+
+    std::priority_queue<std::pair<T, std::size_t>> frontier;
+    while (perm.size() - begin < size) {
+      std::size_t v;
+      if (frontier.empty()) {
+        while (part[rcm[next_seed]] != free_part)
+          ++next_seed;
+        v = rcm[next_seed];
+      } else {
+        auto [w, u] = frontier.top();
+        frontier.pop();
+        if (part[u] != free_part || w != conn[u])
+          continue;
+        v = u;
+      }
+
+      part[v] = k;
+      perm.push_back(v);
+      for (std::size_t u : adj[v])
+        if (part[u] == free_part) {
+          conn[u] += std::abs(A[v * nrows + u]) + std::abs(A[u * nrows + v]);
+          frontier.emplace(conn[u], u);
+        }
+    }
+
+    for (std::size_t i = begin; i < perm.size(); ++i)
+      for (std::size_t u : adj[perm[i]])
+        conn[u] = T(0);
+
+    std::sort(perm.begin() + begin, perm.end(),
+      [&rank](std::size_t a, std::size_t b) { return rank[a] < rank[b]; });
+  }
+
+  return perm;
+}
+
+template <typename T = float, typename Allocator = std::allocator<T>>
+std::vector<std::size_t> make_permutation(
+    Ordering ordering,
+    std::size_t nblocks,
+    std::size_t nrows,
+    const std::vector<T, Allocator>& A) {
+  switch (ordering) {
+    case Ordering::Natural: {
+      std::vector<std::size_t> perm(nrows);
+      for (std::size_t i = 0; i < nrows; ++i)
+        perm[i] = i;
+      return perm;
+    }
+    case Ordering::RCM:       return reverse_cuthill_mckee(nrows, A);
+    case Ordering::Partition: return partition_graph(nblocks, nrows, A);
+    default:
+      throw std::runtime_error("make_permutation: undefined ordering!");
+  }
+}
+
+} // namespace ex_m_thr
+
+#endif // EXAMPLE_REORDERING_H_
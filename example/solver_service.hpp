@@ -0,0 +1,259 @@
+// Copyright (C) 2018 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A_ PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef EXAMPLE_SOLVER_SERVICE_H_
+#define EXAMPLE_SOLVER_SERVICE_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "linear_system.hpp"
+#include "thread_pool.hpp"
+
+namespace ex_m_thr {
+
+// Solves many independent systems on one shared pool. The block sweeps of
+// all systems are tasks of the same pool, so running several solves at once
+// does not oversubscribe the cores. Systems smaller than batch_rows are
+// collected into batches of about batch_rows rows, a batch is one task.
+// Batching only happens while all workers are busy: when a worker is free,
+// the incomplete batch is started at once.
+template <typename T = float, typename Allocator = std::allocator<T>>
+class SolverService {
+public:
+  SolverService<T, Allocator>(
+    std::size_t nthreads, std::size_t batch_rows = 1024);
+  ~SolverService<T, Allocator>();
+  SolverService<T, Allocator>(const SolverService<T, Allocator>&) = delete;
+  SolverService<T, Allocator>& operator=(
+    const SolverService<T, Allocator>&) = delete;
+
+  // Returns the job id, the system must not be used until wait() returns.
+  std::size_t submit(
+    std::shared_ptr<LinearSystem<T, Allocator>> system,
+    Method method = Method::GaussSeidel);
+
+  // Starts the incomplete batch and waits for all jobs. Rethrows the first
+  // error of a job.
+  void wait();
+
+  std::size_t njobs() const;
+  // Submitted jobs that are not finished yet.
+  std::size_t npending() const;
+  // Solved systems per second from the first submit to the last solution.
+  double throughput() const;
+  // Seconds from submit to solution, by job id.
+  std::vector<double> latencies() const;
+  // p in [0, 100], nearest-rank percentile of latencies().
+  double latency_percentile(double p) const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Job {
+    std::shared_ptr<LinearSystem<T, Allocator>> system;
+    Method method;
+    std::size_t id;
+  };
+
+  void flush_batch();
+  void run(const std::vector<Job>& jobs);
+  void wait_all();
+
+  const std::size_t batch_rows_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<Job> batch_;
+  std::size_t batch_nrows_ {0};
+  std::size_t npending_ {0};
+  // Batches given to the pool and not finished yet.
+  std::size_t nbatches_ {0};
+  std::vector<Clock::time_point> submitted_;
+  std::vector<Clock::time_point> finished_;
+  std::exception_ptr error_;
+
+  // Is declared last to be destroyed first: the workers use the fields above.
+  ThreadPool pool_;
+};
+
+template <typename T, typename Allocator>
+SolverService<T, Allocator>::SolverService(
+    std::size_t nthreads, std::size_t batch_rows)
+  : batch_rows_(batch_rows), pool_(nthreads) {}
+
+template <typename T, typename Allocator>
+SolverService<T, Allocator>::~SolverService() { wait_all(); }
+
+template <typename T, typename Allocator>
+std::size_t SolverService<T, Allocator>::submit(
+    std::shared_ptr<LinearSystem<T, Allocator>> system, Method method) {
+  if (!system)
+    throw std::runtime_error("SolverService: system is null!");
+
+  const std::size_t nrows = system->nrows();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  const std::size_t id = submitted_.size();
+  submitted_.push_back(Clock::now());
+  finished_.emplace_back();
+  ++npending_;
+
+  Job job {std::move(system), method, id};
+  if (nrows >= batch_rows_) {
+    ++nbatches_;
+    pool_.submit([this, jobs = std::vector<Job>{std::move(job)}] { run(jobs); });
+  } else {
+    batch_.push_back(std::move(job));
+    batch_nrows_ += nrows;
+    if (batch_nrows_ >= batch_rows_ || nbatches_ < pool_.size())
+      flush_batch();
+  }
+
+  return id;
+}
+
+// mutex_ must be held.
+template <typename T, typename Allocator>
+void SolverService<T, Allocator>::flush_batch() {
+  if (batch_.empty())
+    return;
+
+  ++nbatches_;
+  pool_.submit([this, jobs = std::move(batch_)] { run(jobs); });
+  batch_.clear();
+  batch_nrows_ = 0;
+}
+
+template <typename T, typename Allocator>
+void SolverService<T, Allocator>::run(const std::vector<Job>& jobs) {
+  for (std::size_t k = 0; k < jobs.size(); ++k) {
+    const Job& job = jobs[k];
+    // The pool is attached only while the job runs, the system may be
+    // solved again after the service is gone.
+    std::exception_ptr error;
+    job.system->set_thread_pool(&pool_);
+    try {
+      job.system->solve(job.method);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    job.system->set_thread_pool(nullptr);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_[job.id] = Clock::now();
+    if (error && !error_)
+      error_ = error;
+    // The worker is free again, the jobs collected meanwhile start now.
+    // This is done before the last npending_ decrement, after which
+    // the service may be destroyed.
+    if (k + 1 == jobs.size() && --nbatches_ < pool_.size())
+      flush_batch();
+    if (--npending_ == 0)
+      cv_.notify_all();
+  }
+}
+
+template <typename T, typename Allocator>
+void SolverService<T, Allocator>::wait_all() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  flush_batch();
+  cv_.wait(lock, [this] { return npending_ == 0; });
+}
+
+template <typename T, typename Allocator>
+void SolverService<T, Allocator>::wait() {
+  wait_all();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (error_) {
+    std::exception_ptr error = error_;
+    error_ = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+template <typename T, typename Allocator>
+std::size_t SolverService<T, Allocator>::njobs() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return submitted_.size();
+}
+
+template <typename T, typename Allocator>
+std::size_t SolverService<T, Allocator>::npending() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return npending_;
+}
+
+template <typename T, typename Allocator>
+double SolverService<T, Allocator>::throughput() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (submitted_.empty() || npending_ != 0)
+    return 0.0;
+
+  const auto first = *std::min_element(submitted_.begin(), submitted_.end());
+  const auto last = *std::max_element(finished_.begin(), finished_.end());
+  const double seconds = std::chrono::duration<double>(last - first).count();
+  return seconds > 0.0 ? submitted_.size() / seconds : 0.0;
+}
+
+template <typename T, typename Allocator>
+std::vector<double> SolverService<T, Allocator>::latencies() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (npending_ != 0)
+    throw std::runtime_error("SolverService: jobs are not finished!");
+
+  std::vector<double> result;
+  result.reserve(submitted_.size());
+  for (std::size_t i = 0; i < submitted_.size(); ++i)
+    result.push_back(
+      std::chrono::duration<double>(finished_[i] - submitted_[i]).count());
+
+  return result;
+}
+
+template <typename T, typename Allocator>
+double SolverService<T, Allocator>::latency_percentile(double p) const {
+  if (p < 0.0 || p > 100.0)
+    throw std::runtime_error("SolverService: p is out of [0, 100]!");
+
+  std::vector<double> sorted = latencies();
+  if (sorted.empty())
+    return 0.0;
+  std::sort(sorted.begin(), sorted.end());
+
+  const auto rank = static_cast<std::size_t>(std::ceil(p / 100.0 * sorted.size()));
+  return sorted[rank == 0 ? 0 : rank - 1];
+}
+
+} // namespace ex_m_thr
+
+#endif // EXAMPLE_SOLVER_SERVICE_H_
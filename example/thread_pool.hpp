@@ -0,0 +1,169 @@
+// Copyright (C) 2018 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A_ PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef EXAMPLE_THREAD_POOL_H_
+#define EXAMPLE_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ex_m_thr {
+
+// Fixed-size pool shared by many solvers. parallel_for may be called from
+// a task: the waiting thread takes part in its own loop.
+class ThreadPool {
+public:
+  explicit ThreadPool(std::size_t nthreads);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  std::size_t size() const;
+
+  template <typename F>
+  std::future<void> submit(F f);
+
+  // Calls f(k) for k in [0, n). The calling thread runs indices of this call
+  // only, never other tasks of the pool, then sleeps until the indices taken
+  // by the workers are done.
+  template <typename F>
+  void parallel_for(std::size_t n, F f);
+
+private:
+  void worker();
+
+  std::vector<std::thread> workers_;
+  std::deque<std::packaged_task<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool done_ {false};
+};
+
+inline ThreadPool::ThreadPool(std::size_t nthreads) {
+  if (nthreads == 0)
+    throw std::runtime_error("ThreadPool: nthreads == 0!");
+
+  workers_.reserve(nthreads);
+  for (std::size_t k = 0; k < nthreads; ++k)
+    workers_.emplace_back([this] { worker(); });
+}
+
+inline ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    done_ = true;
+  }
+  cv_.notify_all();
+
+  for(auto& thr : workers_)
+    thr.join();
+}
+
+inline std::size_t ThreadPool::size() const { return workers_.size(); }
+
+template <typename F>
+std::future<void> ThreadPool::submit(F f) {
+  std::packaged_task<void()> task(std::move(f));
+  std::future<void> result = task.get_future();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  cv_.notify_one();
+
+  return result;
+}
+
+template <typename F>
+void ThreadPool::parallel_for(std::size_t n, F f) {
+  if (n == 0)
+    return;
+
+  // The indices are claimed by the calling thread and by the tasks submitted
+  // here. A task that starts after all of them are claimed returns at once,
+  // so f is never touched after parallel_for returned.
+  struct Group {
+    std::atomic<std::size_t> next {0};
+    std::size_t ndone {0};
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable cv;
+  };
+  auto group = std::make_shared<Group>();
+
+  auto run = [group, n, &f] {
+    for (std::size_t k = group->next++; k < n; k = group->next++) {
+      std::exception_ptr error;
+      try {
+        f(k);
+      } catch (...) {
+        error = std::current_exception();
+      }
+
+      std::lock_guard<std::mutex> lock(group->mutex);
+      if (error && !group->error)
+        group->error = error;
+      if (++group->ndone == n)
+        group->cv.notify_all();
+    }
+  };
+
+  for (std::size_t k = 1; k < n; ++k)
+    submit(run);
+  run();
+
+  // The rest is already running on other threads.
+  std::unique_lock<std::mutex> lock(group->mutex);
+  group->cv.wait(lock, [&group, n] { return group->ndone == n; });
+  if (group->error)
+    std::rethrow_exception(group->error);
+}
+
+inline void ThreadPool::worker() {
+  for (;;) {
+    std::packaged_task<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this] { return done_ || !tasks_.empty(); });
+      if (done_ && tasks_.empty())
+        return;
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+
+    task();
+  }
+}
+
+} // namespace ex_m_thr
+
+#endif // EXAMPLE_THREAD_POOL_H_
@@ -0,0 +1,301 @@
+// Copyright (C) 2018 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A_ PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef EXAMPLE_TRANSPORT_H_
+#define EXAMPLE_TRANSPORT_H_
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Define EX_M_THR_WITH_MPI and link MPI to get MpiTransport.
+#ifdef EX_M_THR_WITH_MPI
+#include <mpi.h>
+#endif
+
+namespace ex_m_thr {
+
+// Point-to-point messages between the processes of a distributed solver.
+// Messages between two ranks arrive in the order they were sent, at most
+// one isend and one irecv per peer may be in flight.
+class Transport {
+public:
+  virtual ~Transport() = default;
+
+  virtual std::size_t rank() const = 0;
+  virtual std::size_t size() const = 0;
+
+  // The buffers must stay alive until the returned future is ready.
+  virtual std::future<void> isend(
+    std::size_t dest, const void* data, std::size_t nbytes) = 0;
+  virtual std::future<void> irecv(
+    std::size_t src, void* data, std::size_t nbytes) = 0;
+
+  // Element-wise sum over all ranks, the result is the same on every rank.
+  virtual void allreduce_sum(std::vector<double>& values);
+};
+
+inline void Transport::allreduce_sum(std::vector<double>& values) {
+  const std::size_t nbytes = values.size() * sizeof(double);
+  if (rank() != 0) {
+    isend(0, values.data(), nbytes).get();
+    irecv(0, values.data(), nbytes).get();
+    return;
+  }
+
+  // Rank order keeps the sum bitwise the same from run to run.
+  std::vector<double> other(values.size());
+  for (std::size_t src = 1; src < size(); ++src) {
+    irecv(src, other.data(), nbytes).get();
+    for (std::size_t i = 0; i < values.size(); ++i)
+      values[i] += other[i];
+  }
+
+  std::vector<std::future<void>> sends;
+  for (std::size_t dest = 1; dest < size(); ++dest)
+    sends.push_back(isend(dest, values.data(), nbytes));
+  for (auto& send : sends)
+    send.get();
+}
+
+// Unix domain sockets, one connected socket per pair of ranks. Transfers run
+// on std::async threads, so sends and receives never block each other.
+class SocketTransport : public Transport {
+public:
+  // fds[p] is the socket connected to the rank p, fds[rank] is unused.
+  SocketTransport(std::size_t rank, std::vector<int> fds);
+  virtual ~SocketTransport();
+  SocketTransport(const SocketTransport&) = delete;
+  SocketTransport& operator=(const SocketTransport&) = delete;
+
+  virtual std::size_t rank() const override;
+  virtual std::size_t size() const override;
+
+  virtual std::future<void> isend(
+    std::size_t dest, const void* data, std::size_t nbytes) override;
+  virtual std::future<void> irecv(
+    std::size_t src, void* data, std::size_t nbytes) override;
+
+private:
+  int peer(std::size_t p) const;
+
+  const std::size_t rank_;
+  std::vector<int> fds_;
+};
+
+inline SocketTransport::SocketTransport(std::size_t rank, std::vector<int> fds)
+  : rank_(rank), fds_(std::move(fds)) {
+  if (rank_ >= fds_.size())
+    throw std::runtime_error("SocketTransport: rank >= size!");
+}
+
+inline SocketTransport::~SocketTransport() {
+  for (std::size_t p = 0; p < fds_.size(); ++p)
+    if (p != rank_ && fds_[p] >= 0)
+      ::close(fds_[p]);
+}
+
+inline std::size_t SocketTransport::rank() const { return rank_; }
+
+inline std::size_t SocketTransport::size() const { return fds_.size(); }
+
+inline int SocketTransport::peer(std::size_t p) const {
+  if (p >= fds_.size() || p == rank_)
+    throw std::runtime_error("SocketTransport: wrong peer!");
+  return fds_[p];
+}
+
+inline std::future<void> SocketTransport::isend(
+    std::size_t dest, const void* data, std::size_t nbytes) {
+  const int fd = peer(dest);
+  return std::async(std::launch::async, [fd, data, nbytes] {
+    const char* p = static_cast<const char*>(data);
+    std::size_t done {0};
+    while (done < nbytes) {
+      ssize_t n = ::send(fd, p + done, nbytes - done, MSG_NOSIGNAL);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        throw std::runtime_error(
+          std::string("SocketTransport: send failed: ") + std::strerror(errno));
+      done += static_cast<std::size_t>(n);
+    }
+  });
+}
+
+inline std::future<void> SocketTransport::irecv(
+    std::size_t src, void* data, std::size_t nbytes) {
+  const int fd = peer(src);
+  return std::async(std::launch::async, [fd, data, nbytes] {
+    char* p = static_cast<char*>(data);
+    std::size_t done {0};
+    while (done < nbytes) {
+      ssize_t n = ::recv(fd, p + done, nbytes - done, 0);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n == 0)
+        throw std::runtime_error("SocketTransport: peer closed the socket!");
+      if (n < 0)
+        throw std::runtime_error(
+          std::string("SocketTransport: recv failed: ") + std::strerror(errno));
+      done += static_cast<std::size_t>(n);
+    }
+  });
+}
+
+// Forks nprocs - 1 processes connected by SocketTransport and calls f(transport)
+// in each of them, the calling process is the rank 0. The children must not
+// be started while other threads of the process are running. Returns false if
+// f failed in any child, an error in the rank 0 is rethrown.
+template <typename F>
+bool run_local_processes(std::size_t nprocs, F f) {
+  if (nprocs == 0)
+    throw std::runtime_error("run_local_processes: nprocs == 0!");
+
+  std::vector<std::vector<int>> fds(nprocs, std::vector<int>(nprocs, -1));
+  for (std::size_t a = 0; a < nprocs; ++a)
+    for (std::size_t b = a + 1; b < nprocs; ++b) {
+      int pair[2];
+      if (::socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+        throw std::runtime_error("run_local_processes: socketpair failed!");
+      fds[a][b] = pair[0];
+      fds[b][a] = pair[1];
+    }
+
+  auto close_others = [&fds, nprocs](std::size_t rank) {
+    for (std::size_t a = 0; a < nprocs; ++a)
+      for (std::size_t b = 0; b < nprocs; ++b)
+        if (a != rank && fds[a][b] >= 0)
+          ::close(fds[a][b]);
+  };
+
+  std::vector<pid_t> children;
+  for (std::size_t rank = 1; rank < nprocs; ++rank) {
+    pid_t pid = ::fork();
+    if (pid < 0)
+      throw std::runtime_error("run_local_processes: fork failed!");
+    if (pid == 0) {
+      close_others(rank);
+      int status {0};
+      try {
+        SocketTransport transport(rank, fds[rank]);
+        f(static_cast<Transport&>(transport));
+      } catch (...) {
+        status = 1;
+      }
+      ::_exit(status);
+    }
+    children.push_back(pid);
+  }
+
+  close_others(0);
+  std::exception_ptr error;
+  try {
+    SocketTransport transport(0, fds[0]);
+    f(static_cast<Transport&>(transport));
+  } catch (...) {
+    error = std::current_exception();
+  }
+
+  bool ok {true};
+  for (pid_t pid : children) {
+    int status {0};
+    while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  }
+
+  if (error)
+    std::rethrow_exception(error);
+  return ok;
+}
+
+#ifdef EX_M_THR_WITH_MPI
+// MPI_Init must be called before and MPI_Finalize after the use.
+class MpiTransport : public Transport {
+public:
+  explicit MpiTransport(MPI_Comm comm = MPI_COMM_WORLD);
+
+  virtual std::size_t rank() const override;
+  virtual std::size_t size() const override;
+
+  virtual std::future<void> isend(
+    std::size_t dest, const void* data, std::size_t nbytes) override;
+  virtual std::future<void> irecv(
+    std::size_t src, void* data, std::size_t nbytes) override;
+
+  virtual void allreduce_sum(std::vector<double>& values) override;
+
+private:
+  MPI_Comm comm_;
+  int rank_;
+  int size_;
+};
+
+inline MpiTransport::MpiTransport(MPI_Comm comm) : comm_(comm) {
+  MPI_Comm_rank(comm_, &rank_);
+  MPI_Comm_size(comm_, &size_);
+}
+
+inline std::size_t MpiTransport::rank() const { return rank_; }
+
+inline std::size_t MpiTransport::size() const { return size_; }
+
+// The requests are completed by MPI_Wait in the deferred future.
+inline std::future<void> MpiTransport::isend(
+    std::size_t dest, const void* data, std::size_t nbytes) {
+  MPI_Request request;
+  MPI_Isend(data, static_cast<int>(nbytes), MPI_BYTE, static_cast<int>(dest),
+    0, comm_, &request);
+  return std::async(std::launch::deferred, [request]() mutable {
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+  });
+}
+
+inline std::future<void> MpiTransport::irecv(
+    std::size_t src, void* data, std::size_t nbytes) {
+  MPI_Request request;
+  MPI_Irecv(data, static_cast<int>(nbytes), MPI_BYTE, static_cast<int>(src),
+    0, comm_, &request);
+  return std::async(std::launch::deferred, [request]() mutable {
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+  });
+}
+
+inline void MpiTransport::allreduce_sum(std::vector<double>& values) {
+  MPI_Allreduce(MPI_IN_PLACE, values.data(), static_cast<int>(values.size()),
+    MPI_DOUBLE, MPI_SUM, comm_);
+}
+#endif // EX_M_THR_WITH_MPI
+
+} // namespace ex_m_thr
+
+#endif // EXAMPLE_TRANSPORT_H_
@@ -23,58 +23,411 @@
 #ifndef EXAMPLE_UTILS_H_
 #define EXAMPLE_UTILS_H_
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <stdexcept>
+#include <thread>
+#include <utility>
 #include <vector>
 
 namespace ex_m_thr {
 
+constexpr std::size_t default_chunk_rows = 1024;
+
+// std::allocator that default-initializes instead of value-initializing, so
+// std::vector<T, DefaultInitAllocator<T>>(n) leaves arithmetic T unwritten
+// and the threads that fill it are the first to touch its pages.
+template <typename T>
+class DefaultInitAllocator : public std::allocator<T> {
+public:
+  template <typename U>
+  struct rebind {
+    using other = DefaultInitAllocator<U>;
+  };
+
+  using std::allocator<T>::allocator;
+
+  template <typename U, typename... Args>
+  void construct(U* p, Args&&... args) {
+    if constexpr (sizeof...(Args) == 0)
+      ::new (static_cast<void*>(p)) U;
+    else
+      ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+  }
+};
+
+// Calls f(at, to) for the chunks [at, to) of chunk_rows rows, the next free
+// thread takes the next chunk. nthreads == 0 means all cores. A single chunk
+// runs on the calling thread. Rethrows the first error of a chunk.
+template <typename F>
+void for_each_row_chunk(
+    std::size_t nrows,
+    F f,
+    std::size_t nthreads = 0,
+    std::size_t chunk_rows = default_chunk_rows) {
+  if (chunk_rows == 0)
+    throw std::runtime_error("for_each_row_chunk: chunk_rows == 0!");
+
+  const std::size_t nchunks = (nrows + chunk_rows - 1) / chunk_rows;
+  if (nthreads == 0)
+    nthreads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+  nthreads = std::min(nthreads, nchunks);
+
+  std::atomic<std::size_t> next {0};
+  std::mutex mutex;
+  std::exception_ptr error;
+  auto run = [&] {
+    try {
+      for (std::size_t k = next++; k < nchunks; k = next++)
+        f(k * chunk_rows, std::min(nrows, (k + 1) * chunk_rows));
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error)
+        error = std::current_exception();
+      next = nchunks;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (std::size_t k = 1; k < nthreads; ++k)
+    threads.emplace_back(run);
+  run();
+
+  for(auto& thr : threads)
+    thr.join();
+
+  if (error)
+    std::rethrow_exception(error);
+}
+
+// Row patterns of the test matrices. row(i, emit) calls emit(j, a_ij) for
+// the nonzeros of the row i in ascending j, rows do not depend on each other
+// and are generated concurrently.
+
+// Diagonal blocks with the BlockJacobi row ranges:
+// a_ii = nrows / nblocks + 100, a_ij = 1 inside the block. With
+// nblocks > nrows every row is a 1 x 1 block and the trailing blocks are empty.
+template <typename T = float>
+class BlockPattern {
+public:
+  using value_type = T;
+
+  BlockPattern<T>(std::size_t nrows, std::size_t nblocks);
+
+  std::size_t nrows() const;
+  template <typename F>
+  void row(std::size_t i, F emit) const;
+
+private:
+  std::size_t nrows_;
+  std::size_t offset_;
+  std::size_t balance_;
+};
+
+// a_ii = 2 * bandwidth + 1, a_ij = -1 for 0 < |i - j| <= bandwidth.
 template <typename T = float>
-std::vector<T> generate_square_block_matrix(
-    std::size_t nrows, std::size_t nblocks) {
-  std::vector<T> mat(nrows * nrows);
-
-  const std::size_t offset = nrows / nblocks;
-  const std::size_t balance = nrows - offset * nblocks;
-
-  std::size_t at, to;
-  std::size_t start {0};
-  for (std::size_t k = 0; k < nblocks; ++k) {
-    at = start;
-    to = start + offset;
-    if (k < balance)
-      ++to;
-
-    for (std::size_t i = at; i < to; ++i)
-      for (std::size_t j = at; j < to; ++j)
-        if (i == j) {
-          mat[i * nrows + j] = static_cast<T>(offset + 100);
-        } else {
-          mat[i * nrows + j] = static_cast<T>(1);
-        }
-
-    start = to;
+class BandedPattern {
+public:
+  using value_type = T;
+
+  BandedPattern<T>(std::size_t nrows, std::size_t bandwidth);
+
+  std::size_t nrows() const;
+  template <typename F>
+  void row(std::size_t i, F emit) const;
+
+private:
+  std::size_t nrows_;
+  std::size_t bandwidth_;
+};
+
+// nnz_per_row - 1 off-diagonal entries uniform in [-1, 1) at random columns,
+// a_ii = sum_j |a_ij| + 1. The random numbers of a row are seeded by
+// (seed, i), so the matrix does not depend on the number of threads.
+template <typename T = float>
+class RandomSparsePattern {
+public:
+  using value_type = T;
+
+  RandomSparsePattern<T>(
+    std::size_t nrows, std::size_t nnz_per_row, std::uint64_t seed = 1);
+
+  std::size_t nrows() const;
+  template <typename F>
+  void row(std::size_t i, F emit) const;
+
+private:
+  static std::uint64_t splitmix64(std::uint64_t& state);
+
+  std::size_t nrows_;
+  std::size_t nnz_per_row_;
+  std::uint64_t seed_;
+};
+
+// Rows [first_row, first_row + nrows) of a matrix with ncols columns,
+// the column indices of a row are ascending.
+template <typename T = float>
+struct CsrMatrix {
+  std::size_t first_row {0};
+  std::size_t nrows {0};
+  std::size_t ncols {0};
+  std::vector<std::size_t> offsets {0};
+  std::vector<std::size_t> cols;
+  std::vector<T> values;
+};
+
+template <typename T>
+BlockPattern<T>::BlockPattern(std::size_t nrows, std::size_t nblocks)
+  : nrows_(nrows) {
+  if (nblocks == 0)
+    throw std::runtime_error("BlockPattern: nblocks == 0!");
+
+  offset_ = nrows / nblocks;
+  balance_ = nrows - offset_ * nblocks;
+}
+
+template <typename T>
+std::size_t BlockPattern<T>::nrows() const { return nrows_; }
+
+template <typename T>
+template <typename F>
+void BlockPattern<T>::row(std::size_t i, F emit) const {
+  // The first balance_ blocks have offset_ + 1 rows.
+  const std::size_t long_rows = balance_ * (offset_ + 1);
+  std::size_t at;
+  std::size_t to;
+  if (i < long_rows) {
+    at = i / (offset_ + 1) * (offset_ + 1);
+    to = at + offset_ + 1;
+  } else {
+    at = long_rows + (i - long_rows) / offset_ * offset_;
+    to = at + offset_;
+  }
+
+  for (std::size_t j = at; j < to; ++j)
+    emit(j, i == j ? static_cast<T>(offset_ + 100) : static_cast<T>(1));
+}
+
+template <typename T>
+BandedPattern<T>::BandedPattern(std::size_t nrows, std::size_t bandwidth)
+  : nrows_(nrows), bandwidth_(bandwidth) {}
+
+template <typename T>
+std::size_t BandedPattern<T>::nrows() const { return nrows_; }
+
+template <typename T>
+template <typename F>
+void BandedPattern<T>::row(std::size_t i, F emit) const {
+  const std::size_t at = i > bandwidth_ ? i - bandwidth_ : 0;
+  const std::size_t to = std::min(nrows_, i + bandwidth_ + 1);
+  for (std::size_t j = at; j < to; ++j)
+    emit(j, i == j ? static_cast<T>(2 * bandwidth_ + 1) : static_cast<T>(-1));
+}
+
+template <typename T>
+RandomSparsePattern<T>::RandomSparsePattern(
+    std::size_t nrows, std::size_t nnz_per_row, std::uint64_t seed)
+  : nrows_(nrows), nnz_per_row_(std::min(nnz_per_row, nrows)), seed_(seed) {
+  if (nnz_per_row == 0)
+    throw std::runtime_error("RandomSparsePattern: nnz_per_row == 0!");
+}
+
+template <typename T>
+std::size_t RandomSparsePattern<T>::nrows() const { return nrows_; }
+
+template <typename T>
+std::uint64_t RandomSparsePattern<T>::splitmix64(std::uint64_t& state) {
+  std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+template <typename T>
+template <typename F>
+void RandomSparsePattern<T>::row(std::size_t i, F emit) const {
+  std::uint64_t state = seed_ ^ (static_cast<std::uint64_t>(i) << 32 | i);
+  splitmix64(state);
+
+  std::vector<std::pair<std::size_t, T>> entries;
+  entries.reserve(nnz_per_row_);
+  entries.emplace_back(i, T(0));
+  T diag {1};
+  while (entries.size() < nnz_per_row_) {
+    const std::size_t j = splitmix64(state) % nrows_;
+    if (std::any_of(entries.begin(), entries.end(),
+          [j](const auto& e) { return e.first == j; }))
+      continue;
+
+    // 53 random bits to [-1, 1).
+    const T a = static_cast<T>(
+      static_cast<double>(splitmix64(state) >> 11) * 0x1.0p-52 - 1.0);
+    entries.emplace_back(j, a);
+    diag += std::abs(a);
   }
+  entries.front().second = diag;
+
+  std::sort(entries.begin(), entries.end(),
+    [](const auto& a, const auto& b) { return a.first < b.first; });
+  for (const auto& [j, a] : entries)
+    emit(j, a);
+}
+
+// Dense row-major nrows x nrows matrix, every thread zeroes and writes its
+// own rows. The default allocator leaves the buffer unwritten until then.
+template <
+    typename Pattern,
+    typename Allocator = DefaultInitAllocator<typename Pattern::value_type>>
+std::vector<typename Pattern::value_type, Allocator> generate_dense(
+    const Pattern& pattern,
+    std::size_t nthreads = 0,
+    std::size_t chunk_rows = default_chunk_rows) {
+  using T = typename Pattern::value_type;
+  const std::size_t nrows = pattern.nrows();
+  std::vector<T, Allocator> mat(nrows * nrows);
+
+  auto fill = [&pattern, &mat, nrows](std::size_t at, std::size_t to) {
+    for (std::size_t i = at; i < to; ++i) {
+      T* a = mat.data() + i * nrows;
+      std::fill(a, a + nrows, T(0));
+      pattern.row(i, [a](std::size_t j, T a_ij) { a[j] = a_ij; });
+    }
+  };
+  for_each_row_chunk(nrows, fill, nthreads, chunk_rows);
 
   return mat;
 }
 
-template <typename T = float>
-std::vector<T> mat_vec(const std::vector<T> mat, const std::vector<T> vec) {
+// Counts the nonzeros of every row, then fills the rows in parallel.
+template <typename Pattern>
+CsrMatrix<typename Pattern::value_type> generate_csr(
+    const Pattern& pattern,
+    std::size_t nthreads = 0,
+    std::size_t chunk_rows = default_chunk_rows) {
+  using T = typename Pattern::value_type;
+  CsrMatrix<T> csr;
+  csr.nrows = pattern.nrows();
+  csr.ncols = pattern.nrows();
+  csr.offsets.assign(csr.nrows + 1, 0);
+
+  auto count = [&pattern, &csr](std::size_t at, std::size_t to) {
+    for (std::size_t i = at; i < to; ++i) {
+      std::size_t nnz {0};
+      pattern.row(i, [&nnz](std::size_t, T) { ++nnz; });
+      csr.offsets[i + 1] = nnz;
+    }
+  };
+  for_each_row_chunk(csr.nrows, count, nthreads, chunk_rows);
+
+  for (std::size_t i = 0; i < csr.nrows; ++i)
+    csr.offsets[i + 1] += csr.offsets[i];
+  csr.cols.resize(csr.offsets.back());
+  csr.values.resize(csr.offsets.back());
+
+  auto fill = [&pattern, &csr](std::size_t at, std::size_t to) {
+    for (std::size_t i = at; i < to; ++i) {
+      std::size_t k = csr.offsets[i];
+      pattern.row(i, [&csr, &k](std::size_t j, T a_ij) {
+        csr.cols[k] = j;
+        csr.values[k++] = a_ij;
+      });
+    }
+  };
+  for_each_row_chunk(csr.nrows, fill, nthreads, chunk_rows);
+
+  return csr;
+}
+
+// Streams the matrix without ever holding it whole: sink(chunk) gets
+// every chunk of rows as a CsrMatrix. The sink is called concurrently and
+// in no particular order of the chunks.
+template <typename Pattern, typename Sink>
+void generate_rows(
+    const Pattern& pattern,
+    Sink sink,
+    std::size_t nthreads = 0,
+    std::size_t chunk_rows = default_chunk_rows) {
+  using T = typename Pattern::value_type;
+  auto stream = [&pattern, &sink](std::size_t at, std::size_t to) {
+    CsrMatrix<T> chunk;
+    chunk.first_row = at;
+    chunk.nrows = to - at;
+    chunk.ncols = pattern.nrows();
+    chunk.offsets.reserve(to - at + 1);
+    for (std::size_t i = at; i < to; ++i) {
+      pattern.row(i, [&chunk](std::size_t j, T a_ij) {
+        chunk.cols.push_back(j);
+        chunk.values.push_back(a_ij);
+      });
+      chunk.offsets.push_back(chunk.cols.size());
+    }
+    sink(std::as_const(chunk));
+  };
+  for_each_row_chunk(pattern.nrows(), stream, nthreads, chunk_rows);
+}
+
+// With the default std::allocator the vector is zeroed on the calling thread
+// first, DefaultInitAllocator<T> leaves the whole setup to the threads.
+template <typename T = float, typename Allocator = std::allocator<T>>
+std::vector<T, Allocator> generate_square_block_matrix(
+    std::size_t nrows, std::size_t nblocks, std::size_t nthreads = 0) {
+  return generate_dense<BlockPattern<T>, Allocator>(
+      BlockPattern<T>(nrows, nblocks), nthreads);
+}
+
+// rhs = mat * vec, e.g. for a known solution vec. The rows are summed in
+// parallel, in the same order as sequentially.
+template <typename T = float, typename Allocator = std::allocator<T>>
+std::vector<T> mat_vec(
+    const std::vector<T, Allocator>& mat,
+    const std::vector<T>& vec,
+    std::size_t nthreads = 0) {
   const std::size_t nrows = vec.size();
   if (mat.size() != nrows * nrows)
     throw std::runtime_error("matvec: mat.size() != nrows * nrows!");
 
-  std::vector<T> result;
-  result.reserve(nrows);
-  for(std::size_t i = 0; i < nrows; ++i) {
-    T r {0.0};
-    for (std::size_t j = 0; j < nrows; ++j)
-      r += mat[i * nrows + j] * vec[j];
-    result.push_back(r);
-  }
+  std::vector<T> result(nrows);
+  auto rows = [&mat, &vec, &result, nrows](std::size_t at, std::size_t to) {
+    for (std::size_t i = at; i < to; ++i) {
+      T r {0.0};
+      for (std::size_t j = 0; j < nrows; ++j)
+        r += mat[i * nrows + j] * vec[j];
+      result[i] = r;
+    }
+  };
+  for_each_row_chunk(nrows, rows, nthreads);
+  return result;
+}
+
+template <typename T = float>
+std::vector<T> mat_vec(
+    const CsrMatrix<T>& mat,
+    const std::vector<T>& vec,
+    std::size_t nthreads = 0) {
+  if (mat.offsets.size() != mat.nrows + 1)
+    throw std::runtime_error("matvec: wrong mat.offsets!");
+  if (vec.size() != mat.ncols)
+    throw std::runtime_error("matvec: vec.size() != mat.ncols!");
+
+  std::vector<T> result(mat.nrows);
+  auto rows = [&mat, &vec, &result](std::size_t at, std::size_t to) {
+    for (std::size_t i = at; i < to; ++i) {
+      T r {0.0};
+      for (std::size_t k = mat.offsets[i]; k < mat.offsets[i + 1]; ++k)
+        r += mat.values[k] * vec[mat.cols[k]];
+      result[i] = r;
+    }
+  };
+  for_each_row_chunk(mat.nrows, rows, nthreads);
   return result;
 }
 
 } // namespace ex_m_thr
 
-#endif // EXAMPLE_UTILS_H_
\ No newline at end of file
+#endif // EXAMPLE_UTILS_H_
@@ -0,0 +1,116 @@
+// Copyright (C) 2018 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "arena_allocator.hpp"
+#include "block_linear_system.hpp"
+#include "utils.hpp"
+
+class ArenaAllocatorTests : public ::testing::Test {};
+
+TEST_F(ArenaAllocatorTests, alignment) {
+  ex_m_thr::Arena arena(1UL << 16);
+  ex_m_thr::ArenaAllocator<float> alloc(&arena);
+
+  std::vector<float, ex_m_thr::ArenaAllocator<float>> a(3, 1.0f, alloc);
+  std::vector<float, ex_m_thr::ArenaAllocator<float>> b(5, 2.0f, alloc);
+
+  EXPECT_TRUE(arena.owns(a.data()));
+  EXPECT_TRUE(arena.owns(b.data()));
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(a.data()) % 64, 0);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(b.data()) % 64, 0);
+  EXPECT_EQ(arena.used(), 128);
+
+  float outside {0.0};
+  EXPECT_FALSE(arena.owns(&outside));
+  EXPECT_TRUE(noexcept(arena.deallocate(a.data(), 0)));
+}
+
+TEST_F(ArenaAllocatorTests, reuse) {
+  ex_m_thr::Arena arena(1UL << 16);
+  ex_m_thr::ArenaAllocator<double> alloc(&arena);
+
+  double* p = alloc.allocate(100);
+  double* q = alloc.allocate(10);
+  alloc.deallocate(p, 100);
+  const std::size_t used = arena.used();
+
+  EXPECT_EQ(alloc.allocate(100), p);
+  EXPECT_EQ(arena.used(), used);
+
+  // The last block is given back to the arena.
+  alloc.deallocate(q, 10);
+  EXPECT_EQ(arena.used(), used - 128);
+
+  // Beyond the capacity the memory is taken from the heap.
+  double* r = alloc.allocate(1UL << 14);
+  EXPECT_FALSE(arena.owns(r));
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(r) % 64, 0);
+  alloc.deallocate(r, 1UL << 14);
+}
+
+TEST_F(ArenaAllocatorTests, huge_pages) {
+  ex_m_thr::Arena arena(1000, ex_m_thr::HugePages::Explicit);
+
+  EXPECT_NE(arena.huge_pages(), ex_m_thr::HugePages::None);
+  EXPECT_EQ(arena.capacity(), ex_m_thr::Arena::huge_page_size);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(arena.allocate(1000))
+    % ex_m_thr::Arena::huge_page_size, 0);
+}
+
+TEST_F(ArenaAllocatorTests, block_linear_system) {
+  std::size_t nblocks {4};
+  std::size_t max_steps {100};
+  float accuracy {1.0e-6};
+  std::size_t nrows {1UL << 8};
+
+  std::vector<float> A(
+    ex_m_thr::generate_square_block_matrix(nrows, nblocks));
+  std::vector<float> lhs(nrows, 1.0f);
+  std::vector<float> rhs(ex_m_thr::mat_vec(A, lhs));
+
+  ex_m_thr::Arena arena(1UL << 20, ex_m_thr::HugePages::Transparent);
+  ex_m_thr::ArenaAllocator<float> alloc(&arena);
+
+  ex_m_thr::BlockLinearSystem<float> bls(
+    nblocks, max_steps, accuracy, nrows, A, rhs);
+  ex_m_thr::BlockLinearSystem<float, ex_m_thr::ArenaAllocator<float>> bls_arena(
+    nblocks, max_steps, accuracy, nrows, A, rhs,
+    ex_m_thr::Ordering::Natural, 1, 0, 0, alloc);
+
+  const std::size_t used = arena.used();
+  EXPECT_GT(used, nrows * nrows * sizeof(float));
+
+  bls.solve();
+  bls_arena.solve();
+
+  EXPECT_GT(bls_arena.nsteps(), 4);
+  EXPECT_EQ(bls_arena.nsteps(), bls.nsteps());
+  EXPECT_EQ(bls_arena.solution(), bls.solution());
+  // The vectors of a step come from the free list, the arena grows by
+  // a few vectors rather than by a few per step.
+  EXPECT_LT(arena.used() - used, 4 * nrows * sizeof(float));
+}
@@ -20,9 +20,17 @@
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "block_jacobi.hpp"
+#include "block_linear_system.hpp"
+#include "utils.hpp"
+
+#include "test_utils.hpp"
 
 class BlockJacobiTests : public ::testing::Test {};
 
@@ -39,4 +47,104 @@ TEST_F(BlockJacobiTests, simple) {
   std::vector<float> lhs({1.0, 2.0, 1.0});
 
   EXPECT_EQ(bj.times(rhs), lhs);
-}
\ No newline at end of file
+}
+
+TEST_F(BlockJacobiTests, nlevels) {
+  std::size_t nrows {2};
+  std::vector<float> A({2.0, 1.0, 1.0, 2.0});
+
+  EXPECT_EQ(ex_m_thr::BlockJacobi(2, nrows, A, 2).nlevels(), 2);
+  EXPECT_THROW(ex_m_thr::BlockJacobi(2, nrows, A, 3), std::runtime_error);
+}
+
+TEST_F(BlockJacobiTests, level_sweep) {
+  std::size_t m {32};
+  std::size_t nrows {m * m};
+  std::vector<float> A(test_utils::laplacian_2d(m));
+  std::vector<float> lhs(nrows);
+  std::vector<float> rhs(nrows, 1.0f);
+  for (std::size_t i = 0; i < nrows; ++i)
+    lhs[i] = static_cast<float>(i % 7) - 3.0f;
+
+  for (std::size_t overlap : {0, 3}) {
+    ex_m_thr::BlockJacobi plain(2, nrows, A, 1, overlap, 2);
+    ex_m_thr::BlockJacobi levels(2, nrows, A, 1, overlap, 8);
+
+    EXPECT_EQ(plain.nthreads_per_block(), 1);
+    EXPECT_EQ(levels.nthreads_per_block(), 4);
+    EXPECT_EQ(levels.step_solution_gauss_seidel(lhs, rhs),
+      plain.step_solution_gauss_seidel(lhs, rhs));
+  }
+}
+
+TEST_F(BlockJacobiTests, block_linear_system_nthreads) {
+  std::size_t max_steps {100};
+  float accuracy {1.0e-6};
+  std::size_t m {16};
+  std::size_t nrows {m * m};
+  std::vector<float> A(test_utils::laplacian_2d(m));
+  std::vector<float> lhs(nrows, 1.0f);
+  std::vector<float> rhs(ex_m_thr::mat_vec(A, lhs));
+
+  ex_m_thr::BlockLinearSystem plain(
+    2, max_steps, accuracy, nrows, A, rhs,
+    ex_m_thr::Ordering::Natural, 1, 0, 2);
+  ex_m_thr::BlockLinearSystem levels(
+    2, max_steps, accuracy, nrows, A, rhs,
+    ex_m_thr::Ordering::Natural, 1, 0, 4);
+
+  plain.solve();
+  levels.solve();
+
+  EXPECT_EQ(levels.nsteps(), plain.nsteps());
+  EXPECT_EQ(levels.solution(), plain.solution());
+}
+
+TEST_F(BlockJacobiTests, symmetric_two_level) {
+  std::size_t m {5};
+  std::size_t nrows {m * m};
+  std::vector<float> A_float(test_utils::laplacian_2d(m));
+  std::vector<double> A(A_float.begin(), A_float.end());
+  ex_m_thr::BlockJacobi<double> bj(3, nrows, A, 2, 0, 1);
+
+  // Columns of the preconditioner: the step from lhs = 0 for rhs = e_j.
+  for (double w : {1.0, 1.3}) {
+    std::vector<double> B(nrows * nrows);
+    const std::vector<double> zero(nrows, 0.0);
+    for (std::size_t j = 0; j < nrows; ++j) {
+      std::vector<double> e(nrows, 0.0);
+      e[j] = 1.0;
+      std::vector<double> z(bj.step_solution_ssor(zero, e, w));
+      for (std::size_t i = 0; i < nrows; ++i)
+        B[i * nrows + j] = z[i];
+    }
+
+    double asymmetry {0.0};
+    for (std::size_t i = 0; i < nrows; ++i)
+      for (std::size_t j = 0; j < i; ++j)
+        asymmetry = std::max(
+          asymmetry, std::abs(B[i * nrows + j] - B[j * nrows + i]));
+    EXPECT_LT(asymmetry, 1.0e-12);
+  }
+}
+
+TEST_F(BlockJacobiTests, two_level_more_blocks_than_rows) {
+  std::size_t max_steps {100};
+  float accuracy {1.0e-6};
+  std::size_t nrows {3};
+  std::vector<float> A({
+    4.0, -1.0,  0.0,
+   -1.0,  4.0, -1.0,
+    0.0, -1.0,  4.0
+  });
+  std::vector<float> lhs({1.0, 2.0, 3.0});
+  std::vector<float> rhs(ex_m_thr::mat_vec(A, lhs));
+
+  ex_m_thr::BlockLinearSystem bls(
+    5, max_steps, accuracy, nrows, A, rhs, ex_m_thr::Ordering::Natural, 2);
+  bls.solve();
+
+  std::vector<float> solution(bls.solution());
+  for (std::size_t i = 0; i < nrows; ++i)
+    EXPECT_NEAR(solution[i], lhs[i], 1.0e-5);
+}
@@ -28,6 +28,8 @@
 #include "block_linear_system.hpp"
 #include "utils.hpp"
 
+#include "test_utils.hpp"
+
 class BlockLinearSystemTests : public ::testing::Test {};
 
 TEST_F(BlockLinearSystemTests, simple) {
@@ -51,7 +53,7 @@ TEST_F(BlockLinearSystemTests, ex_1) {
 
   ex_m_thr::BlockLinearSystem bls(nblocks, max_steps, accuracy, nrows, A, rhs);
 
-  std::vector<float> exact_solution({0.83486235, 2.3486238, -0.92405063, 1.7594937});
+  std::vector<float> exact_solution({1.0, 2.0, -1.0, 1.0});
 
   bls.solve();
 
@@ -89,4 +91,86 @@ TEST_F(BlockLinearSystemTests, ex_2) {
   }
 
   EXPECT_TRUE(std::sqrt(dd) < 1.0e-5);
-}
\ No newline at end of file
+}
+
+TEST_F(BlockLinearSystemTests, two_level) {
+  std::size_t max_steps{1000};
+  float accuracy {1.0e-6};
+  std::size_t nrows {256};
+  std::vector<float> A(test_utils::tridiagonal(nrows, 2.05));
+  std::vector<float> lhs(nrows, 1.0f);
+  std::vector<float> rhs(ex_m_thr::mat_vec(A, lhs));
+
+  std::size_t nsteps_first {0};
+  for (std::size_t nblocks : {4, 16, 64}) {
+    ex_m_thr::BlockLinearSystem one_level(
+      nblocks, max_steps, accuracy, nrows, A, rhs);
+    ex_m_thr::BlockLinearSystem two_level(
+      nblocks, max_steps, accuracy, nrows, A, rhs,
+      ex_m_thr::Ordering::Natural, 2);
+
+    one_level.solve();
+    two_level.solve();
+
+    EXPECT_LT(test_utils::error_norm(two_level.solution(), lhs), 1.0e-3);
+
+    EXPECT_LT(two_level.nsteps(), one_level.nsteps());
+    if (nsteps_first == 0)
+      nsteps_first = two_level.nsteps();
+    EXPECT_LE(two_level.nsteps(), nsteps_first);
+  }
+}
+
+TEST_F(BlockLinearSystemTests, overlap) {
+  std::size_t nblocks {64};
+  std::size_t max_steps{1000};
+  float accuracy {1.0e-6};
+  std::size_t nrows {256};
+  std::vector<float> A(test_utils::tridiagonal(nrows, 2.2));
+  std::vector<float> lhs(nrows, 1.0f);
+  std::vector<float> rhs(ex_m_thr::mat_vec(A, lhs));
+
+  ex_m_thr::BlockLinearSystem no_overlap(
+    nblocks, max_steps, accuracy, nrows, A, rhs);
+  ex_m_thr::BlockLinearSystem overlap(
+    nblocks, max_steps, accuracy, nrows, A, rhs,
+    ex_m_thr::Ordering::Natural, 1, 4);
+
+  no_overlap.solve();
+  overlap.solve();
+
+  EXPECT_LT(test_utils::error_norm(overlap.solution(), lhs), 1.0e-4);
+  EXPECT_LT(overlap.nsteps(), no_overlap.nsteps());
+}
+
+TEST_F(BlockLinearSystemTests, symmetric) {
+  std::size_t nblocks {8};
+  std::size_t max_steps{1000};
+  float accuracy {1.0e-6};
+  std::size_t nrows {256};
+  std::vector<float> A(test_utils::tridiagonal(nrows, 2.2));
+  std::vector<float> lhs(nrows, 1.0f);
+  std::vector<float> rhs(ex_m_thr::mat_vec(A, lhs));
+
+  for (std::size_t overlap : {0, 4}) {
+    ex_m_thr::BlockLinearSystem gs(
+      nblocks, max_steps, accuracy, nrows, A, rhs,
+      ex_m_thr::Ordering::Natural, 1, overlap);
+    ex_m_thr::BlockLinearSystem sgs(
+      nblocks, max_steps, accuracy, nrows, A, rhs,
+      ex_m_thr::Ordering::Natural, 1, overlap);
+    ex_m_thr::BlockLinearSystem ssor(
+      nblocks, max_steps, accuracy, nrows, A, rhs,
+      ex_m_thr::Ordering::Natural, 2, overlap);
+
+    gs.solve();
+    sgs.solve(ex_m_thr::Method::SymmetricGaussSeidel);
+    ssor.solve(ex_m_thr::Method::SSOR);
+
+    for (const auto& bls : {sgs, ssor}) {
+      EXPECT_LT(test_utils::error_norm(bls.solution(), lhs), 1.0e-3);
+    }
+
+    EXPECT_LT(sgs.nsteps(), gs.nsteps());
+  }
+}
@@ -0,0 +1,97 @@
+// Copyright (C) 2018 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "block_linear_system.hpp"
+#include "distributed_block_linear_system.hpp"
+#include "transport.hpp"
+#include "utils.hpp"
+
+#include "test_utils.hpp"
+
+class DistributedBlockLinearSystemTests : public ::testing::Test {
+protected:
+  // Tridiagonal matrix with a long-range coupling between i and i + nrows / 2.
+  static std::vector<float> matrix(std::size_t nrows) {
+    std::vector<float> A(nrows * nrows);
+    for (std::size_t i = 0; i < nrows; ++i) {
+      A[i * nrows + i] = 3.0;
+      if (i > 0) A[i * nrows + i - 1] = -1.0;
+      if (i + 1 < nrows) A[i * nrows + i + 1] = -1.0;
+      A[i * nrows + (i + nrows / 2) % nrows] = 0.5;
+    }
+    return A;
+  }
+};
+
+TEST_F(DistributedBlockLinearSystemTests, allreduce) {
+  bool ok = ex_m_thr::run_local_processes(4, [](ex_m_thr::Transport& transport) {
+    std::vector<double> values({1.0, static_cast<double>(transport.rank())});
+    transport.allreduce_sum(values);
+    if (values != std::vector<double>({4.0, 6.0}))
+      throw std::runtime_error("allreduce_sum: wrong sum!");
+  });
+
+  EXPECT_TRUE(ok);
+}
+
+TEST_F(DistributedBlockLinearSystemTests, solve) {
+  std::size_t nprocs {3};
+  std::size_t max_steps {100};
+  float accuracy {1.0e-6};
+  std::size_t nrows {90};
+  std::vector<float> A(matrix(nrows));
+  std::vector<float> lhs(nrows);
+  for (std::size_t i = 0; i < nrows; ++i)
+    lhs[i] = 1.0f + static_cast<float>(i % 4);
+  std::vector<float> rhs(ex_m_thr::mat_vec(A, lhs));
+
+  ex_m_thr::BlockLinearSystem bls(nprocs, max_steps, accuracy, nrows, A, rhs);
+  bls.solve();
+  const std::size_t nsteps = bls.nsteps();
+
+  bool ok = ex_m_thr::run_local_processes(nprocs,
+      [&](ex_m_thr::Transport& transport) {
+    std::vector<std::size_t> offsets(
+      ex_m_thr::block_offsets(nrows, transport.size()));
+    const std::size_t at = offsets[transport.rank()];
+    const std::size_t to = offsets[transport.rank() + 1];
+
+    ex_m_thr::DistributedBlockLinearSystem<float> dls(
+      transport, max_steps, accuracy, nrows,
+      std::vector<float>(A.begin() + at * nrows, A.begin() + to * nrows),
+      std::vector<float>(rhs.begin() + at, rhs.begin() + to));
+    dls.solve();
+
+    if (test_utils::error_norm(dls.solution(), lhs, at) > 1.0e-4)
+      throw std::runtime_error("solve: wrong solution!");
+    if (dls.nsteps() + 1 < nsteps || dls.nsteps() > nsteps + 1)
+      throw std::runtime_error("solve: nsteps differs from BlockLinearSystem!");
+  });
+
+  EXPECT_TRUE(ok);
+}
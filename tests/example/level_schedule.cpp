@@ -0,0 +1,108 @@
+// Copyright (C) 2018 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "level_schedule.hpp"
+#include "linear_system.hpp"
+#include "utils.hpp"
+
+#include "test_utils.hpp"
+
+class LevelScheduleTests : public ::testing::Test {};
+
+TEST_F(LevelScheduleTests, wavefronts) {
+  std::size_t m {8};
+  std::vector<float> A(test_utils::laplacian_2d(m));
+
+  ex_m_thr::LevelSchedule<float> schedule(m * m, A, 0, m * m);
+
+  EXPECT_EQ(schedule.nlevels(), 2 * m - 1);
+  EXPECT_EQ(schedule.level(0), std::vector<std::size_t>({0}));
+  EXPECT_EQ(schedule.level(1), std::vector<std::size_t>({1, m}));
+  EXPECT_TRUE(schedule.is_parallel(2));
+  EXPECT_FALSE(schedule.is_parallel(8));
+}
+
+TEST_F(LevelScheduleTests, dense_is_sequential) {
+  std::size_t nrows {16};
+  std::vector<float> A(ex_m_thr::generate_square_block_matrix(nrows, 1));
+
+  ex_m_thr::LevelSchedule<float> schedule(nrows, A, 0, nrows);
+
+  EXPECT_EQ(schedule.nlevels(), nrows);
+  EXPECT_FALSE(schedule.is_parallel(2));
+}
+
+TEST_F(LevelScheduleTests, sweep_matches_sequential) {
+  std::size_t m {12};
+  std::size_t nrows {m * m};
+  std::size_t at {20};
+  std::size_t to {100};
+  std::vector<float> A(test_utils::laplacian_2d(m));
+  std::vector<float> lhs(nrows);
+  for (std::size_t i = 0; i < nrows; ++i)
+    lhs[i] = static_cast<float>(i % 7) - 3.0f;
+
+  // Plain forward sweep over the rows [at, to).
+  std::vector<float> x(to - at, 1.0f);
+  for (std::size_t i = at; i < to; ++i) {
+    float xi = x[i - at];
+    for (std::size_t j = 0; j < at; ++j)
+      xi -= A[i * nrows + j] * lhs[j];
+    for (std::size_t j = at; j < i; ++j)
+      xi -= A[i * nrows + j] * x[j - at];
+    for (std::size_t j = i + 1; j < nrows; ++j)
+      xi -= A[i * nrows + j] * lhs[j];
+    x[i - at] = xi / A[i * nrows + i];
+  }
+
+  ex_m_thr::LevelSchedule<float> schedule(nrows, A, at, to);
+  std::vector<float> x1(to - at, 1.0f);
+  std::vector<float> x4(to - at, 1.0f);
+  schedule.step_solution_gauss_seidel(A, lhs, x1.data(), 1);
+  schedule.step_solution_gauss_seidel(A, lhs, x4.data(), 4);
+
+  EXPECT_EQ(x1, x);
+  EXPECT_EQ(x4, x);
+}
+
+TEST_F(LevelScheduleTests, linear_system) {
+  std::size_t max_steps {100};
+  float accuracy {1.0e-6};
+  std::size_t m {16};
+  std::size_t nrows {m * m};
+  std::vector<float> A(test_utils::laplacian_2d(m));
+  std::vector<float> lhs(nrows, 1.0f);
+  std::vector<float> rhs(ex_m_thr::mat_vec(A, lhs));
+
+  ex_m_thr::LinearSystem sequential(max_steps, accuracy, nrows, A, rhs);
+  ex_m_thr::LinearSystem parallel(max_steps, accuracy, nrows, A, rhs, 4);
+
+  sequential.solve();
+  parallel.solve();
+
+  EXPECT_EQ(parallel.nsteps(), sequential.nsteps());
+  EXPECT_EQ(parallel.solution(), sequential.solution());
+}
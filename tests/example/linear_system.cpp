@@ -28,6 +28,8 @@
 #include "linear_system.hpp"
 #include "utils.hpp"
 
+#include "test_utils.hpp"
+
 class LinearSystemTests : public ::testing::Test {};
 
 TEST_F(LinearSystemTests, test_default) {
@@ -97,4 +99,27 @@ TEST_F(LinearSystemTests, ex_2) {
   }
 
   EXPECT_TRUE(std::sqrt(dd) < 1.0e-5);
-}
\ No newline at end of file
+}
+
+TEST_F(LinearSystemTests, symmetric) {
+  std::size_t max_steps{500};
+  float accuracy {1.0e-6};
+  std::size_t nrows {64};
+  std::vector<float> A(test_utils::tridiagonal(nrows, 2.2));
+  std::vector<float> lhs(nrows, 1.0f);
+  std::vector<float> rhs(ex_m_thr::mat_vec(A, lhs));
+
+  ex_m_thr::LinearSystem gs(max_steps, accuracy, nrows, A, rhs);
+  ex_m_thr::LinearSystem sgs(max_steps, accuracy, nrows, A, rhs);
+  ex_m_thr::LinearSystem ssor(max_steps, accuracy, nrows, A, rhs);
+
+  gs.solve();
+  sgs.solve(ex_m_thr::Method::SymmetricGaussSeidel);
+  ssor.solve(ex_m_thr::Method::SSOR);
+
+  for (const auto& ls : {sgs, ssor}) {
+    EXPECT_LT(test_utils::error_norm(ls.solution(), lhs), 1.0e-4);
+  }
+
+  EXPECT_LT(sgs.nsteps(), gs.nsteps());
+}
@@ -0,0 +1,121 @@
+// Copyright (C) 2018 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+#include "block_linear_system.hpp"
+#include "reordering.hpp"
+#include "utils.hpp"
+
+#include "test_utils.hpp"
+
+class ReorderingTests : public ::testing::Test {
+protected:
+  // Tridiagonal matrix with rows shuffled by i -> (i * 7) % nrows.
+  static std::vector<float> shuffled_tridiagonal(std::size_t nrows) {
+    std::vector<float> A(nrows * nrows);
+    for (std::size_t i = 0; i < nrows; ++i) {
+      std::size_t pi = (i * 7) % nrows;
+      A[pi * nrows + pi] = 4.0;
+      if (i > 0) {
+        std::size_t pj = ((i - 1) * 7) % nrows;
+        A[pi * nrows + pj] = -1.5;
+        A[pj * nrows + pi] = -1.5;
+      }
+    }
+    return A;
+  }
+
+  static bool is_permutation(const std::vector<std::size_t>& perm) {
+    std::vector<bool> seen(perm.size(), false);
+    for (std::size_t i : perm) {
+      if (i >= perm.size() || seen[i])
+        return false;
+      seen[i] = true;
+    }
+    return true;
+  }
+};
+
+TEST_F(ReorderingTests, rcm_bandwidth) {
+  std::size_t nrows {64};
+  std::vector<float> A(shuffled_tridiagonal(nrows));
+
+  std::vector<std::size_t> perm(ex_m_thr::reverse_cuthill_mckee(nrows, A));
+
+  EXPECT_TRUE(is_permutation(perm));
+  EXPECT_GT(ex_m_thr::bandwidth(nrows, A), 1);
+  EXPECT_EQ(ex_m_thr::bandwidth(nrows, ex_m_thr::permute_matrix(nrows, A, perm)), 1);
+}
+
+TEST_F(ReorderingTests, partition_blocks) {
+  std::size_t nrows {30};
+  std::size_t nblocks {3};
+  std::vector<float> B(ex_m_thr::generate_square_block_matrix(nrows, nblocks));
+
+  std::vector<std::size_t> shuffle(nrows);
+  for (std::size_t i = 0; i < nrows; ++i)
+    shuffle[i] = (i * 7) % nrows;
+  std::vector<float> A(ex_m_thr::permute_matrix(nrows, B, shuffle));
+
+  std::vector<std::size_t> perm(ex_m_thr::partition_graph(nblocks, nrows, A));
+  EXPECT_TRUE(is_permutation(perm));
+
+  std::vector<float> C(ex_m_thr::permute_matrix(nrows, A, perm));
+  for (std::size_t i = 0; i < nrows; ++i)
+    for (std::size_t j = 0; j < nrows; ++j)
+      if (i / 10 != j / 10) {
+        EXPECT_EQ(C[i * nrows + j], 0.0f);
+      }
+}
+
+TEST_F(ReorderingTests, block_linear_system) {
+  std::size_t nblocks {4};
+  std::size_t max_steps {200};
+  float accuracy {1.0e-6};
+  std::size_t nrows {64};
+  std::vector<float> A(shuffled_tridiagonal(nrows));
+  std::vector<float> lhs(nrows);
+  for (std::size_t i = 0; i < nrows; ++i)
+    lhs[i] = 1.0f + static_cast<float>(i % 5);
+  std::vector<float> rhs(ex_m_thr::mat_vec(A, lhs));
+
+  std::size_t nsteps[3];
+  const ex_m_thr::Ordering orderings[3] = {
+    ex_m_thr::Ordering::Natural,
+    ex_m_thr::Ordering::RCM,
+    ex_m_thr::Ordering::Partition
+  };
+  for (std::size_t k = 0; k < 3; ++k) {
+    ex_m_thr::BlockLinearSystem bls(
+      nblocks, max_steps, accuracy, nrows, A, rhs, orderings[k]);
+    bls.solve();
+    nsteps[k] = bls.nsteps();
+
+    EXPECT_LT(test_utils::error_norm(bls.solution(), lhs), 1.0e-4);
+  }
+
+  EXPECT_LT(nsteps[1], nsteps[0]);
+  EXPECT_LT(nsteps[2], nsteps[0]);
+}
@@ -0,0 +1,137 @@
+// Copyright (C) 2018 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "block_linear_system.hpp"
+#include "solver_service.hpp"
+#include "utils.hpp"
+
+#include "test_utils.hpp"
+
+class SolverServiceTests : public ::testing::Test {};
+
+TEST_F(SolverServiceTests, many_systems) {
+  std::size_t max_steps {100};
+  float accuracy {1.0e-6};
+
+  std::vector<std::shared_ptr<ex_m_thr::LinearSystem<float>>> systems;
+  std::vector<std::vector<float>> exact;
+  for (std::size_t k = 0; k < 40; ++k) {
+    const std::size_t nblocks = 1 + k % 4;
+    const std::size_t nrows = k % 10 == 0 ? 256 : 16 + k;
+    std::vector<float> A(ex_m_thr::generate_square_block_matrix(nrows, nblocks));
+    std::vector<float> lhs(nrows, 1.0f + static_cast<float>(k));
+    std::vector<float> rhs(ex_m_thr::mat_vec(A, lhs));
+
+    if (k % 2 == 0) {
+      systems.push_back(std::make_shared<ex_m_thr::BlockLinearSystem<float>>(
+        nblocks, max_steps, accuracy, nrows, A, rhs));
+    } else {
+      systems.push_back(std::make_shared<ex_m_thr::LinearSystem<float>>(
+        max_steps, accuracy, nrows, A, rhs));
+    }
+    exact.push_back(lhs);
+  }
+
+  ex_m_thr::SolverService<float> service(2, 128);
+  for (std::size_t k = 0; k < systems.size(); ++k) {
+    const auto method = k % 3 == 0
+      ? ex_m_thr::Method::SymmetricGaussSeidel
+      : ex_m_thr::Method::GaussSeidel;
+    EXPECT_EQ(service.submit(systems[k], method), k);
+  }
+  service.wait();
+
+  for (std::size_t k = 0; k < systems.size(); ++k) {
+    const std::vector<float> zero(exact[k].size(), 0.0f);
+    EXPECT_LT(test_utils::error_norm(systems[k]->solution(), exact[k]),
+      1.0e-5 * test_utils::error_norm(exact[k], zero));
+  }
+
+  EXPECT_EQ(service.njobs(), systems.size());
+  EXPECT_EQ(service.latencies().size(), systems.size());
+  EXPECT_GT(service.throughput(), 0.0);
+  EXPECT_LE(service.latency_percentile(50), service.latency_percentile(99));
+  EXPECT_LE(service.latency_percentile(99), service.latency_percentile(100));
+}
+
+TEST_F(SolverServiceTests, error) {
+  ex_m_thr::SolverService<float> service(2);
+  service.submit(std::make_shared<ex_m_thr::LinearSystem<float>>(),
+    static_cast<ex_m_thr::Method>(-1));
+
+  EXPECT_THROW(service.wait(), std::runtime_error);
+}
+
+TEST_F(SolverServiceTests, solve_after_service) {
+  std::size_t nblocks {4};
+  std::size_t max_steps {100};
+  float accuracy {1.0e-6};
+  std::size_t nrows {256};
+  std::vector<float> A(ex_m_thr::generate_square_block_matrix(nrows, nblocks));
+  std::vector<float> lhs(nrows, 1.0f);
+  std::vector<float> rhs(ex_m_thr::mat_vec(A, lhs));
+
+  auto system = std::make_shared<ex_m_thr::BlockLinearSystem<float>>(
+    nblocks, max_steps, accuracy, nrows, A, rhs);
+  {
+    ex_m_thr::SolverService<float> service(2);
+    service.submit(system);
+    service.wait();
+  }
+  std::vector<float> solution(system->solution());
+
+  // The blocks run on own threads again, not on the destroyed pool.
+  system->solve(ex_m_thr::Method::SymmetricGaussSeidel);
+
+  EXPECT_EQ(system->solution().size(), nrows);
+  EXPECT_LT(test_utils::error_norm(system->solution(), solution), 1.0e-4);
+}
+
+TEST_F(SolverServiceTests, lone_small_job) {
+  std::size_t max_steps {100};
+  float accuracy {1.0e-6};
+  std::size_t nrows {16};
+  std::vector<float> A(ex_m_thr::generate_square_block_matrix(nrows, 2));
+  std::vector<float> lhs(nrows, 1.0f);
+  std::vector<float> rhs(ex_m_thr::mat_vec(A, lhs));
+
+  // The batch is far from full, but the pool is idle.
+  ex_m_thr::SolverService<float> service(2, 1024);
+  service.submit(std::make_shared<ex_m_thr::LinearSystem<float>>(
+    max_steps, accuracy, nrows, A, rhs));
+
+  const auto deadline =
+    std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (service.npending() != 0 && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  EXPECT_EQ(service.npending(), 0);
+  service.wait();
+}
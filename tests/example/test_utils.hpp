@@ -0,0 +1,73 @@
+// Copyright (C) 2018 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef TESTS_EXAMPLE_TEST_UTILS_H_
+#define TESTS_EXAMPLE_TEST_UTILS_H_
+
+#include <cmath>
+#include <vector>
+
+// Matrices and checks shared by the tests.
+namespace test_utils {
+
+// 1D Laplacian shifted by diag - 2.
+inline std::vector<float> tridiagonal(std::size_t nrows, float diag) {
+  std::vector<float> A(nrows * nrows);
+  for (std::size_t i = 0; i < nrows; ++i) {
+    A[i * nrows + i] = diag;
+    if (i > 0) A[i * nrows + i - 1] = -1.0;
+    if (i + 1 < nrows) A[i * nrows + i + 1] = -1.0;
+  }
+  return A;
+}
+
+// 5-point Laplacian on the m x m grid shifted by 0.5.
+inline std::vector<float> laplacian_2d(std::size_t m) {
+  const std::size_t nrows = m * m;
+  std::vector<float> A(nrows * nrows);
+  for (std::size_t x = 0; x < m; ++x)
+    for (std::size_t y = 0; y < m; ++y) {
+      const std::size_t i = x * m + y;
+      A[i * nrows + i] = 4.5;
+      if (x > 0)     A[i * nrows + i - m] = -1.0;
+      if (x + 1 < m) A[i * nrows + i + m] = -1.0;
+      if (y > 0)     A[i * nrows + i - 1] = -1.0;
+      if (y + 1 < m) A[i * nrows + i + 1] = -1.0;
+    }
+  return A;
+}
+
+// ||x - exact||_2, x may hold the rows [at, at + x.size()) only.
+template <typename T = float>
+T error_norm(
+    const std::vector<T>& x, const std::vector<T>& exact, std::size_t at = 0) {
+  T dd {0.0};
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    T d = x[i] - exact[at + i];
+    dd += d * d;
+  }
+  return std::sqrt(dd);
+}
+
+} // namespace test_utils
+
+#endif // TESTS_EXAMPLE_TEST_UTILS_H_
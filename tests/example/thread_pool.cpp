@@ -0,0 +1,85 @@
+// Copyright (C) 2018 Rustam Sayfutdinov (rstm.sf@gmail.com)
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+// BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "thread_pool.hpp"
+
+class ThreadPoolTests : public ::testing::Test {};
+
+TEST_F(ThreadPoolTests, parallel_for) {
+  ex_m_thr::ThreadPool pool(3);
+  std::vector<int> done(100, 0);
+
+  pool.parallel_for(done.size(), [&done](std::size_t k) { done[k] += 1; });
+
+  EXPECT_EQ(done, std::vector<int>(100, 1));
+}
+
+TEST_F(ThreadPoolTests, nested_parallel_for) {
+  ex_m_thr::ThreadPool pool(2);
+  std::atomic<std::size_t> count {0};
+
+  pool.parallel_for(8, [&pool, &count](std::size_t) {
+    pool.parallel_for(8, [&count](std::size_t) { ++count; });
+  });
+
+  EXPECT_EQ(count.load(), 64);
+}
+
+TEST_F(ThreadPoolTests, error) {
+  ex_m_thr::ThreadPool pool(2);
+
+  EXPECT_THROW(
+    pool.parallel_for(4, [](std::size_t k) {
+      if (k == 3)
+        throw std::runtime_error("k == 3");
+    }),
+    std::runtime_error);
+}
+
+TEST_F(ThreadPoolTests, only_own_tasks) {
+  ex_m_thr::ThreadPool pool(1);
+  std::promise<void> release;
+  std::shared_future<void> released(release.get_future());
+  std::atomic<bool> foreign_done {false};
+
+  // The only worker is blocked, the foreign task waits in the queue.
+  auto blocked = pool.submit([released] { released.wait(); });
+  auto foreign = pool.submit([&foreign_done] { foreign_done = true; });
+
+  std::vector<int> done(8, 0);
+  pool.parallel_for(done.size(), [&done](std::size_t k) { done[k] += 1; });
+
+  EXPECT_EQ(done, std::vector<int>(8, 1));
+  EXPECT_FALSE(foreign_done.load());
+
+  release.set_value();
+  blocked.get();
+  foreign.get();
+  EXPECT_TRUE(foreign_done.load());
+}
@@ -20,6 +20,12 @@
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "utils.hpp"
@@ -39,4 +45,122 @@ TEST_F(UtilsTests, generate_mat) {
   });
 
   EXPECT_EQ(mat, expect_mat);
-}
\ No newline at end of file
+}
+
+TEST_F(UtilsTests, generate_mat_more_blocks_than_rows) {
+  std::vector<float> mat(ex_m_thr::generate_square_block_matrix(3, 5));
+  std::vector<float> expect_mat({
+    100.0,   0.0,   0.0,
+      0.0, 100.0,   0.0,
+      0.0,   0.0, 100.0
+  });
+
+  EXPECT_EQ(mat, expect_mat);
+}
+
+TEST_F(UtilsTests, generate_mat_blocks) {
+  std::size_t nrows = 3001;
+  std::size_t nblocks = 7;
+  std::vector<float> mat(
+    ex_m_thr::generate_square_block_matrix(nrows, nblocks, 4));
+
+  const std::size_t offset = nrows / nblocks;
+  const std::size_t balance = nrows - offset * nblocks;
+  std::size_t at {0};
+  bool is_equal {true};
+  for (std::size_t k = 0; k < nblocks; ++k) {
+    const std::size_t to = at + offset + (k < balance ? 1 : 0);
+    for (std::size_t i = at; i < to; ++i)
+      for (std::size_t j = 0; j < nrows; ++j) {
+        float a {0.0};
+        if (i == j)
+          a = static_cast<float>(offset + 100);
+        else if (j >= at && j < to)
+          a = 1.0;
+        is_equal = is_equal && mat[i * nrows + j] == a;
+      }
+    at = to;
+  }
+
+  EXPECT_TRUE(is_equal);
+
+  // Rows zeroed by the threads instead of up front.
+  auto uninit = ex_m_thr::generate_square_block_matrix<
+    float, ex_m_thr::DefaultInitAllocator<float>>(nrows, nblocks, 4);
+  EXPECT_TRUE(std::equal(uninit.begin(), uninit.end(), mat.begin()));
+}
+
+TEST_F(UtilsTests, sinks) {
+  ex_m_thr::RandomSparsePattern<double> pattern(2000, 8, 42);
+
+  auto csr = ex_m_thr::generate_csr(pattern, 4, 100);
+  EXPECT_EQ(csr.nrows, 2000);
+  EXPECT_EQ(csr.offsets.back(), 2000 * 8);
+
+  // The same matrix for any number of threads and any chunk size.
+  auto csr_1 = ex_m_thr::generate_csr(pattern, 1);
+  EXPECT_EQ(csr.cols, csr_1.cols);
+  EXPECT_EQ(csr.values, csr_1.values);
+
+  auto dense = ex_m_thr::generate_dense(pattern, 3, 64);
+  std::vector<double> streamed(2000 * 2000);
+  std::mutex mutex;
+  std::size_t nrows_streamed {0};
+  ex_m_thr::generate_rows(pattern, [&](const ex_m_thr::CsrMatrix<double>& c) {
+    for (std::size_t i = 0; i < c.nrows; ++i)
+      for (std::size_t k = c.offsets[i]; k < c.offsets[i + 1]; ++k)
+        streamed[(c.first_row + i) * 2000 + c.cols[k]] = c.values[k];
+    std::lock_guard<std::mutex> lock(mutex);
+    nrows_streamed += c.nrows;
+  }, 4, 333);
+
+  EXPECT_EQ(nrows_streamed, 2000);
+  EXPECT_TRUE(std::equal(dense.begin(), dense.end(), streamed.begin()));
+
+  bool is_dominant {true};
+  bool is_sorted {true};
+  for (std::size_t i = 0; i < csr.nrows; ++i) {
+    double off {0.0};
+    double diag {0.0};
+    for (std::size_t k = csr.offsets[i]; k < csr.offsets[i + 1]; ++k) {
+      if (csr.cols[k] == i)
+        diag = csr.values[k];
+      else
+        off += std::abs(csr.values[k]);
+      if (k > csr.offsets[i])
+        is_sorted = is_sorted && csr.cols[k - 1] < csr.cols[k];
+    }
+    is_dominant = is_dominant && diag > off;
+  }
+
+  EXPECT_TRUE(is_dominant);
+  EXPECT_TRUE(is_sorted);
+}
+
+TEST_F(UtilsTests, mat_vec) {
+  std::size_t nrows = 3000;
+  ex_m_thr::BandedPattern<float> pattern(nrows, 3);
+
+  auto mat = ex_m_thr::generate_dense(pattern);
+  auto csr = ex_m_thr::generate_csr(pattern);
+  EXPECT_EQ(mat[0], 7.0f);
+  EXPECT_EQ(mat[1], -1.0f);
+  EXPECT_EQ(mat[4], 0.0f);
+  EXPECT_EQ(csr.offsets[1], 4);
+  EXPECT_EQ(csr.offsets[5] - csr.offsets[4], 7);
+
+  std::vector<float> vec(nrows);
+  for (std::size_t i = 0; i < nrows; ++i)
+    vec[i] = static_cast<float>(i % 17) - 8.0f;
+
+  std::vector<float> rhs_1(ex_m_thr::mat_vec(mat, vec, 1));
+  std::vector<float> rhs_4(ex_m_thr::mat_vec(mat, vec, 4));
+  std::vector<float> rhs_csr(ex_m_thr::mat_vec(csr, vec, 4));
+
+  EXPECT_EQ(rhs_1, rhs_4);
+  EXPECT_EQ(rhs_1, rhs_csr);
+
+  vec.pop_back();
+  EXPECT_THROW(ex_m_thr::mat_vec(csr, vec), std::runtime_error);
+  EXPECT_THROW(ex_m_thr::mat_vec(mat, vec), std::runtime_error);
+}